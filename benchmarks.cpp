@@ -0,0 +1,345 @@
+// Benchmarks of kaizen.h against the plain code it replaces. Inputs come from fixed
+// seeds, so the numbers of two runs, or two builds, are comparable. Every line
+// reports the median and the minimum of --runs timed runs, for the baseline first.
+// Usage: kaizen_benchmarks [--filter point_array,kd_tree,version,log] [--runs 15] [--size 1000000]
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <regex>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "kaizen.h"
+
+namespace {
+
+struct options {
+    std::string filter;       // comma-separated benchmark groups, all of them when empty
+    size_t      runs = 15;
+    size_t      size = 1'000'000;
+};
+
+using stats = zen::execution_stats<zen::timer::nsec>;
+
+double ms(zen::timer::nsec d) { return static_cast<double>(d.count()) / 1e6; }
+
+void report(const char* name, const stats& baseline, const stats& zen)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-28s %10.3f ms %10.3f ms   | %10.3f ms %10.3f ms   | %6.2fx\n",
+        name, ms(baseline.median), ms(baseline.min), ms(zen.median), ms(zen.min),
+        static_cast<double>(baseline.median.count()) / static_cast<double>(std::max<int64_t>(1, zen.median.count())));
+    zen::print(line);
+}
+
+// Same, in nanoseconds per item, for costs too small to read in milliseconds
+void report_ns(const char* name, const stats& baseline, const stats& zen)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-28s %10.1f ns %10.1f ns   | %10.1f ns %10.1f ns   | %6.2fx\n",
+        name, static_cast<double>(baseline.median.count()), static_cast<double>(baseline.min.count()),
+        static_cast<double>(zen.median.count()), static_cast<double>(zen.min.count()),
+        static_cast<double>(baseline.median.count()) / static_cast<double>(std::max<int64_t>(1, zen.median.count())));
+    zen::print(line);
+}
+
+void header(const char* group, const char* baseline, const char* zen)
+{
+    char line[320];
+    std::snprintf(line, sizeof(line), "\n%s\n  %-28s %-29s | %-29s |\n  %-28s %10s    %10s      | %10s    %10s      | speedup\n",
+        group, "", baseline, zen, "", "median", "min", "median", "min");
+    zen::print(line);
+}
+
+void note(const char* name, const stats& s)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-28s %10.3f ms %10.3f ms\n", name, ms(s.median), ms(s.min));
+    zen::print(line);
+}
+
+bool selected(const options& o, std::string_view group)
+{
+    if (o.filter.empty())
+        return true;
+    for (size_t begin = 0; begin <= o.filter.size(); ) {
+        const size_t end = std::min(o.filter.find(',', begin), o.filter.size());
+        if (std::string_view(o.filter).substr(begin, end - begin) == group)
+            return true;
+        begin = end + 1;
+    }
+    return false;
+}
+
+std::vector<zen::point2d> random_points(size_t n, uint64_t seed)
+{
+    zen::xoshiro256ss engine(seed);
+    std::vector<double> coordinates(2 * n);
+    zen::fill_random(std::span<double>(coordinates), 0.0, 1.0, engine);
+    std::vector<zen::point2d> points(n);
+    for (size_t i = 0; i < n; ++i)
+        points[i] = zen::point2d(coordinates[2 * i], coordinates[2 * i + 1]);
+    return points;
+}
+
+// ------------------------------------------------------------------------------------------ point_array
+
+// Loops over a std::vector<zen::point2d> against the batch operations of zen::point2d_array
+void bench_point_array(const options& o)
+{
+    header("point_array", "std::vector<zen::point2d>", "zen::point2d_array");
+
+    std::vector<zen::point2d> aos = random_points(o.size, 1);
+    zen::point2d_array        soa(aos);
+    const zen::point2d        p(0.25, -0.5);
+    std::vector<double>       out(o.size);
+
+    report("add(point)",
+        zen::measure_execution([&] { for (auto& a : aos) a = a + p; zen::clobber_memory(); }, o.runs),
+        zen::measure_execution([&] { soa.add(p); zen::clobber_memory(); }, o.runs));
+
+    report("scale",
+        zen::measure_execution([&] { for (auto& a : aos) a = a * 1.000001; zen::clobber_memory(); }, o.runs),
+        zen::measure_execution([&] { soa.scale(1.000001); zen::clobber_memory(); }, o.runs));
+
+    report("distances",
+        zen::measure_execution([&] {
+            for (size_t i = 0; i < aos.size(); ++i) {
+                const zen::point2d d = aos[i] - p;
+                out[i] = std::sqrt(d.x() * d.x() + d.y() * d.y());
+            }
+            zen::clobber_memory();
+        }, o.runs),
+        zen::measure_execution([&] { soa.distances(p, out); zen::clobber_memory(); }, o.runs));
+
+    report("dots",
+        zen::measure_execution([&] {
+            for (size_t i = 0; i < aos.size(); ++i)
+                out[i] = aos[i].x() * p.x() + aos[i].y() * p.y();
+            zen::clobber_memory();
+        }, o.runs),
+        zen::measure_execution([&] { soa.dots(p, out); zen::clobber_memory(); }, o.runs));
+
+    report("bounding_box",
+        zen::measure_execution([&] {
+            zen::point2d lo = aos[0], hi = aos[0];
+            for (const auto& a : aos) {
+                lo = zen::point2d(std::min(lo.x(), a.x()), std::min(lo.y(), a.y()));
+                hi = zen::point2d(std::max(hi.x(), a.x()), std::max(hi.y(), a.y()));
+            }
+            return std::make_pair(lo, hi);
+        }, o.runs),
+        zen::measure_execution([&] { return soa.bounding_box(); }, o.runs));
+
+    report("centroid",
+        zen::measure_execution([&] {
+            zen::point2d c;
+            for (const auto& a : aos)
+                c = c + a;
+            return c / static_cast<double>(aos.size());
+        }, o.runs),
+        zen::measure_execution([&] { return soa.centroid(); }, o.runs));
+}
+
+// ------------------------------------------------------------------------------------------ kd_tree
+
+// The k nearest points by a full scan, closest first with ties by index, like kd_tree2d::nearest()
+std::vector<size_t> scan_nearest(const std::vector<zen::point2d>& points, const zen::point2d& q, size_t k,
+    std::vector<std::pair<double, size_t>>& candidates)
+{
+    candidates.clear();
+    for (size_t i = 0; i < points.size(); ++i) {
+        const double dx = points[i].x() - q.x(), dy = points[i].y() - q.y();
+        candidates.emplace_back(dx * dx + dy * dy, i);
+    }
+    k = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+    std::vector<size_t> result(k);
+    for (size_t i = 0; i < k; ++i)
+        result[i] = candidates[i].second;
+    return result;
+}
+
+std::vector<size_t> scan_within(const std::vector<zen::point2d>& points, const zen::point2d& q, double radius)
+{
+    std::vector<size_t> result;
+    for (size_t i = 0; i < points.size(); ++i) {
+        const double dx = points[i].x() - q.x(), dy = points[i].y() - q.y();
+        if (dx * dx + dy * dy <= radius * radius)
+            result.push_back(i);
+    }
+    return result;
+}
+
+// Batched kNN and radius queries by linear scans against zen::kd_tree2d, on uniform
+// points in the unit square. The tree's answers are checked against the scans first.
+void bench_kd_tree(const options& o)
+{
+    header("kd_tree", "linear scan", "zen::kd_tree2d");
+
+    const size_t n = std::max<size_t>(1, o.size / 5);
+    const std::vector<zen::point2d> points  = random_points(n, 2);
+    const std::vector<zen::point2d> queries = random_points(2000, 3);
+    const std::span<const zen::point2d> knn_queries(queries.data(), 200);
+    const size_t k      = 8;
+    const double radius = 0.01;
+
+    const zen::kd_tree2d tree(points);
+    std::vector<std::pair<double, size_t>> candidates;
+    const std::vector<size_t> nearest = tree.nearest(knn_queries, k);
+    const zen::neighbours     within  = tree.within(queries, radius);
+    bool agree = true;
+    for (size_t i = 0; i < knn_queries.size(); ++i) {
+        const auto expected = scan_nearest(points, knn_queries[i], k, candidates);
+        agree &= std::equal(expected.begin(), expected.end(), nearest.begin() + i * expected.size());
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        std::vector<size_t> found(within[i].begin(), within[i].end());
+        std::sort(found.begin(), found.end());
+        agree &= found == scan_within(points, queries[i], radius);
+    }
+    if (!agree)
+        zen::print(zen::color::red("  THE TREE AND THE SCANS DISAGREE\n"));
+
+    report("nearest, 200 x k=8",
+        zen::measure_execution([&] {
+            size_t checksum = 0;
+            for (const auto& q : knn_queries)
+                checksum += scan_nearest(points, q, k, candidates).front();
+            return checksum;
+        }, o.runs),
+        zen::measure_execution([&] { return tree.nearest(knn_queries, k); }, o.runs));
+
+    report("within, 2000 x r=0.01",
+        zen::measure_execution([&] {
+            size_t found = 0;
+            for (const auto& q : queries)
+                found += scan_within(points, q, radius).size();
+            return found;
+        }, o.runs),
+        zen::measure_execution([&] { return tree.within(queries, radius); }, o.runs));
+
+    note("build (size / 5 points)", zen::measure_execution([&] { return zen::kd_tree2d(points).size(); }, o.runs));
+}
+
+// ------------------------------------------------------------------------------------------ version
+
+// Parsing and sorting --size version strings, the way zen::version did it before (std::regex,
+// std::stoi and component by component comparison) against zen::version now
+void bench_version(const options& o)
+{
+    header("version", "std::regex + std::stoi", "zen::version");
+
+    zen::xoshiro256ss engine(4);
+    std::vector<std::string> texts(o.size);
+    for (auto& t : texts) {
+        char text[48];
+        std::snprintf(text, sizeof(text), "%d.%d.%d.%d", static_cast<int>(engine() % 20), static_cast<int>(engine() % 100),
+            static_cast<int>(engine() % 1000), static_cast<int>(engine() % 1'000'000));
+        t = text;
+    }
+
+    const auto regex_parse = [](const std::string& text) {
+        static const std::regex rx_version{R"((\d+)\.(\d+)\.(\d+)\.(\d+))"};
+        std::array<int, 4> v{};
+        if (std::smatch sm; std::regex_match(text, sm, rx_version))
+            v = { std::stoi(sm[1]), std::stoi(sm[2]), std::stoi(sm[3]), std::stoi(sm[4]) };
+        return v;
+    };
+
+    std::vector<std::array<int, 4>> arrays;
+    std::vector<zen::version>       versions;
+    report("parse",
+        zen::measure_execution([&] {
+            arrays.clear();
+            for (const auto& t : texts)
+                arrays.push_back(regex_parse(t));
+            zen::clobber_memory();
+        }, o.runs),
+        zen::measure_execution([&] {
+            versions.clear();
+            for (const auto& t : texts)
+                versions.emplace_back(t);
+            zen::clobber_memory();
+        }, o.runs));
+    if (!std::equal(arrays.begin(), arrays.end(), versions.begin(), versions.end(),
+            [](const std::array<int, 4>& a, const zen::version& v) { return a == v; }))
+        zen::print(zen::color::red("  THE TWO PARSERS DISAGREE\n"));
+
+    // Both sorts start over from the parsed order, so the copies are timed on both sides
+    report("sort",
+        zen::measure_execution([&] { auto v = arrays;   std::sort(v.begin(), v.end()); return v.front(); }, o.runs),
+        zen::measure_execution([&] { auto v = versions; std::sort(v.begin(), v.end()); return v.front(); }, o.runs));
+}
+
+// ------------------------------------------------------------------------------------------ log
+
+// The producer-side cost of a zen::log() line: writing it to the sink against queuing it
+// for the async_logger. The sink discards what it gets, so no run waits on a terminal.
+// Every run logs a batch small enough for the thread's ring, and the logger is
+// stopped and started again between runs, out of the timed region, to empty it.
+void bench_log(const options& o)
+{
+    constexpr size_t lines = 1000;
+    auto& logger = zen::async_logger::instance();
+    const auto values = [] {
+        for (size_t i = 0; i < lines; ++i)
+            zen::log("trial", i, "sum", 0.5 * static_cast<double>(i));
+    };
+    const auto text = [] {
+        for (size_t i = 0; i < lines; ++i)
+            zen::log("tick");
+    };
+    const auto per_line = [&](bool async, const auto& batch) {
+        std::vector<zen::timer::nsec> samples;
+        for (size_t run = 0; run < o.runs; ++run) {
+            if (async) logger.start();
+            samples.push_back(zen::measure_execution(batch) / lines);
+            if (async) logger.stop();
+        }
+        return zen::internal::make_execution_stats(std::move(samples));
+    };
+
+    std::ostream discard(nullptr);
+    zen::sink().set_stream(discard);
+    logger.start();
+    zen::log("warm-up"); // registers the thread's ring, outside of the timed runs
+    logger.stop();
+    const uint64_t dropped_before = logger.dropped();
+    const stats values_sync  = per_line(false, values);
+    const stats values_async = per_line(true, values);
+    const stats text_sync    = per_line(false, text);
+    const stats text_async   = per_line(true, text);
+    const uint64_t dropped = logger.dropped() - dropped_before;
+    zen::sink().set_stream(std::cout);
+
+    header("log", "sink().write()", "zen::async_logger");
+    report_ns("log(4 values), per line", values_sync, values_async);
+    report_ns("log(\"tick\"), per line", text_sync, text_async);
+    if (dropped > 0)
+        zen::print(zen::color::red("  SOME LINES WERE DROPPED, THE ASYNC RUNS ARE TOO SHORT\n"));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    zen::cmd_args args(argv, argc);
+    options o;
+    if (auto v = args.get_options("--filter"); !v.empty()) o.filter = v[0];
+    if (auto v = args.get_options("--runs");   !v.empty()) o.runs   = std::stoul(v[0]);
+    if (auto v = args.get_options("--size");   !v.empty()) o.size   = std::stoul(v[0]);
+
+    char line[96];
+    std::snprintf(line, sizeof(line), "kaizen benchmarks: %zu runs each, size %zu\n", o.runs, o.size);
+    zen::print(line);
+
+    if (selected(o, "point_array")) bench_point_array(o);
+    if (selected(o, "kd_tree"))     bench_kd_tree(o);
+    if (selected(o, "version"))     bench_version(o);
+    if (selected(o, "log"))         bench_log(o);
+    return 0;
+}
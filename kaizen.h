@@ -26,6 +26,7 @@
 
 // Since the order of these #includes doesn't matter,
 // they're sorted in descending length for aesthetics
+#include <memory_resource>
 #include <unordered_map>
 #include <unordered_set>
 #include <forward_list>
@@ -35,27 +36,75 @@
 #include <functional>
 #include <algorithm>
 #include <stdexcept>
+#include <exception>
 #include <optional>
 #include <iostream>
 #include <iterator>
+#include <charconv>
 #include <fstream>
 #include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
 #include <ostream>
 #include <utility>
 #include <string>
 #include <vector>
+#include <memory>
 #include <random>
 #include <chrono>
+#include <thread>
+#include <cstdio>
 #include <atomic>
+#include <limits>
+#include <mutex>
 #include <regex>
 #include <array>
 #include <deque>
 #include <ctime>
 #include <queue>
+#include <cmath>
 #include <stack>
+#include <span>
 #include <list>
 #include <set>
 #include <map>
+#include <bit>
+#include <new>
+
+#if defined(_WIN32)
+#include <io.h>     // _isatty
+#else
+#include <unistd.h> // isatty
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h> // mmap for the huge pages of zen::arena
+#include <sys/time.h> // setitimer, SIGPROF, the signal context and dladdr for zen::sampler
+#include <signal.h>
+#include <ucontext.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#endif
+
+// The standard execution policies are opt-in, see PARALLEL below
+#if defined(ZEN_STD_EXECUTION)
+#include <execution>
+#endif
+
+// SIMD kernels are compiled per instruction set through target attributes, see SIMD below
+#if defined(__x86_64__) || defined(_M_X64)
+    #define ZEN_SIMD_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define ZEN_TARGET(isa) // MSVC compiles any intrinsic without special flags
+    #else
+        #define ZEN_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#else
+    #define ZEN_SIMD_X86 0
+#endif
 
 namespace zen {
 
@@ -156,6 +205,39 @@ struct stackonly
     static void  operator delete[](void*)    = delete;
 };
 
+// Lifts the stack-only restriction off a zen container for the places where
+// it has to live elsewhere: std::unique_ptr, pools, arenas (placement new),
+// long-lived structures. It's still the same container and binds to a
+// reference to it. To allocate the elements themselves from an arena as
+// well, use the std::pmr variants in zen::pmr (see COMPOSITES).
+// Example: auto v = std::make_unique<zen::heapable<zen::vector<int>>>(10, 0);
+//          auto p = new (buffer) zen::heapable<zen::map<int, int>>();
+template<class T>
+class heapable : public T
+{
+public:
+    using T::T; // inherit constructors, has to be explicit
+
+    heapable() = default;
+    heapable(const T& x) : T(x) {}
+    heapable(T&& x) : T(std::move(x)) {}
+
+    // These hide the deleted ones of zen::stackonly
+    static void* operator new(  std::size_t n)                     { return ::operator new(  n); }
+    static void* operator new[](std::size_t n)                     { return ::operator new[](n); }
+    static void* operator new(  std::size_t n, std::align_val_t a) { return ::operator new(  n, a); }
+    static void* operator new[](std::size_t n, std::align_val_t a) { return ::operator new[](n, a); }
+    static void* operator new(  std::size_t, void* p) noexcept     { return p; } // placement
+    static void* operator new[](std::size_t, void* p) noexcept     { return p; }
+
+    static void  operator delete(  void* p) noexcept                     { ::operator delete(  p); }
+    static void  operator delete[](void* p) noexcept                     { ::operator delete[](p); }
+    static void  operator delete(  void* p, std::align_val_t a) noexcept { ::operator delete(  p, a); }
+    static void  operator delete[](void* p, std::align_val_t a) noexcept { ::operator delete[](p, a); }
+    static void  operator delete(  void*, void*) noexcept                {}
+    static void  operator delete[](void*, void*) noexcept                {}
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////// TESTING
 
 #define BEGIN_TEST    zen::log("BEGIN", zen::repeat("-", 50), __func__)
@@ -168,6 +250,79 @@ std::atomic<int> TEST_CASE_FAIL_COUNT = 0; // atomic in case tests are ever para
 bool REPORT_TC_PASS = false; // by default, don't report passes to avoid excessive chatter
 bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
 
+namespace internal {
+    // What zen::run_tests() records about the test running on a thread. While a thread
+    // has one, zen::print() and zen::log() append to its output instead of writing to
+    // the sink, so the lines of tests that run side by side don't interleave. The
+    // threads that the zen::execution::par overloads start share the context of the
+    // thread that called them, hence the atomics and the mutex.
+    struct test_context {
+        std::mutex       mutex;
+        std::string      output;
+        std::atomic<int> passes = 0;
+        std::atomic<int> fails  = 0;
+
+        void append(const std::string_view line)
+        {
+            std::lock_guard lock(mutex);
+            output += line;
+        }
+    };
+
+    inline thread_local test_context* current_test = nullptr;
+
+    inline void count_test_case(bool passed)
+    {
+        ++(passed ? TEST_CASE_PASS_COUNT : TEST_CASE_FAIL_COUNT);
+        if (current_test)
+            ++(passed ? current_test->passes : current_test->fails);
+    }
+
+    // Runs f on a new thread that reports to the test of the calling thread, if any
+    template<class F>
+    std::thread test_aware_thread(F f)
+    {
+        return std::thread([f = std::move(f), context = current_test]() mutable {
+            current_test = context;
+            f();
+        });
+    }
+} // namespace internal
+
+// ZEN_TEST defines a test function and registers it, under its name, for zen::run_tests()
+// (see TEST RUNNER). Test functions that already exist are registered with register_test().
+// Example: ZEN_TEST(version_parsing) {
+//              BEGIN_TEST;
+//              ZEN_EXPECT(zen::version("1.2.3.4").major() == 1);
+//          }
+//          zen::register_test("string_trimming", test_string_trimming);
+// Register tests before the first run_tests() starts, typically during static initialization.
+#define ZEN_TEST(name) \
+    static void name(); \
+    [[maybe_unused]] static const bool zen_test_registered_##name = zen::register_test(#name, name); \
+    static void name()
+
+struct test_case {
+    std::string           name;
+    std::function<void()> function;
+};
+
+namespace internal {
+    inline std::vector<test_case>& test_registry()
+    {
+        static std::vector<test_case> tests;
+        return tests;
+    }
+} // namespace internal
+
+inline bool register_test(std::string name, std::function<void()> function)
+{
+    internal::test_registry().push_back({ std::move(name), std::move(function) });
+    return true;
+}
+
+inline const std::vector<test_case>& registered_tests() { return internal::test_registry(); }
+
 #define ZEN_STATIC_ASSERT(X, M) static_assert(X, "ZEN STATIC ASSERTION FAILED. "#M ": " #X)
 
 // ZEN_EXPECT checks its expression parameter and spits out the expression if it fails.
@@ -183,12 +338,12 @@ bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
         if (expression) { \
             if (zen::REPORT_TC_PASS) \
                 zen::log(zen::color::green("CASE PASS:"), #expression); \
-            ++zen::TEST_CASE_PASS_COUNT; \
+            zen::internal::count_test_case(true); \
         } \
         if (!(expression)) { \
             if (zen::REPORT_TC_FAIL) \
                 zen::log(zen::color::red("CASE FAIL:"), __func__, "EXPECTED:", #expression); \
-            ++zen::TEST_CASE_FAIL_COUNT; \
+            zen::internal::count_test_case(false); \
         } \
     } while (0)
 
@@ -211,7 +366,7 @@ bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
             exception_caught = true; \
             if (zen::REPORT_TC_PASS) \
                 zen::log(zen::color::green("CASE PASS:"), #expression); \
-            ++zen::TEST_CASE_PASS_COUNT; \
+            zen::internal::count_test_case(true); \
             break; \
         } \
         catch (...) { \
@@ -221,7 +376,7 @@ bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
                         "EXPECTED `" #expression \
                         "` TO THROW AN EXCEPTION OF TYPE `" #exception_type \
                         "`, BUT IT THROWS ANOTHER TYPE."); \
-            ++zen::TEST_CASE_FAIL_COUNT; \
+            zen::internal::count_test_case(false); \
             break; \
         } \
         if (!exception_caught) { \
@@ -229,7 +384,7 @@ bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
                 zen::log(zen::color::red("CASE FAIL:"), __func__, \
                         "EXPECTED `" #expression \
                         "` TO THROW AN EXCEPTION, BUT IT DOES NOT."); \
-            ++zen::TEST_CASE_FAIL_COUNT; \
+            zen::internal::count_test_case(false); \
         } \
     } while(0)
 
@@ -253,13 +408,13 @@ bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
             if (zen::REPORT_TC_FAIL) \
                 zen::log(zen::color::red("CASE FAIL:"), __func__, \
                         "EXPECTED `" #expression "` NOT TO THROW ANY EXCEPTION, BUT IT DID."); \
-            ++zen::TEST_CASE_FAIL_COUNT; \
+            zen::internal::count_test_case(false); \
             break; \
         } \
         if (!exception_caught) { \
             if (zen::REPORT_TC_PASS) \
                 zen::log(zen::color::green("CASE PASS:"), #expression); \
-            ++zen::TEST_CASE_PASS_COUNT; \
+            zen::internal::count_test_case(true); \
         } \
     } while(0)
 
@@ -267,15 +422,93 @@ bool REPORT_TC_FAIL = true;  // by default, do    report fails (should be few)
 // Example: zen::print(zen::color::red(str));
 // Example: std::cout( zen::color::red(str));
 // Result: Red-colored str in the console.
+// When stdout isn't a terminal (output piped into a file or another program), or when
+// the NO_COLOR environment variable is set (https://no-color.org), only the plain text
+// is written. color::set_enabled() overrides the detection either way.
 namespace color {
+    inline bool enabled();
+
+    namespace internal {
+        inline bool detect()
+        {
+            const char* no_color = std::getenv("NO_COLOR");
+            if (no_color && *no_color)
+                return false;
+#if defined(_WIN32)
+            return _isatty(_fileno(stdout)) != 0;
+#else
+            return isatty(fileno(stdout)) != 0;
+#endif
+        }
+
+        // -1 until detected on first use, then 0 or 1
+        inline std::atomic<int>& state()
+        {
+            static std::atomic<int> s{-1};
+            return s;
+        }
+
+        // Escape sequences go straight into the destination buffer, no temporaries
+        inline void append(std::string& out, const std::string_view text, int code)
+        {
+            if (!enabled()) {
+                out += text;
+                return;
+            }
+            char buf[8];
+            out += "\033[";
+            out.append(buf, std::to_chars(buf, buf + sizeof(buf), code).ptr);
+            out += 'm';
+            out += text;
+            out += "\033[0m";
+        }
+    } // namespace internal
+
+    inline bool enabled()
+    {
+        int s = internal::state().load(std::memory_order_relaxed);
+        if (s < 0) {
+            s = internal::detect() ? 1 : 0;
+            internal::state().store(s, std::memory_order_relaxed);
+        }
+        return s == 1;
+    }
+
+    inline void set_enabled(bool on) { internal::state().store(on ? 1 : 0, std::memory_order_relaxed); }
+
     class color_string {
     public:
         color_string(const std::string_view s, int c) : text(s), code(c) {}
         const std::string text;
         const int /*col*/ code;
 
+        void append_to(std::string& out) const { internal::append(out, text, code); }
+
         friend std::ostream& operator<<(std::ostream& os, const color_string& cw) {
-            os << "\033[" << cw.code << "m" << cw.text << "\033[0m";
+            if (enabled())
+                os << "\033[" << cw.code << "m" << cw.text << "\033[0m";
+            else
+                os << cw.text;
+            return os;
+        }
+    };
+
+    // A non-owning color_string: it doesn't copy the text, which must
+    // therefore outlive it. Ideal for literals and for temporaries
+    // consumed within the same expression, as in print(views::red(s)).
+    class color_view {
+    public:
+        constexpr color_view(const std::string_view s, int c) : text(s), code(c) {}
+        const std::string_view text;
+        const int /*col*/ code;
+
+        void append_to(std::string& out) const { internal::append(out, text, code); }
+
+        friend std::ostream& operator<<(std::ostream& os, const color_view& cw) {
+            if (enabled())
+                os << "\033[" << cw.code << "m" << cw.text << "\033[0m";
+            else
+                os << cw.text;
             return os;
         }
     };
@@ -289,6 +522,19 @@ namespace color {
     color_string magenta(const std::string_view s) { return color_string(s, 35); }
     color_string cyan   (const std::string_view s) { return color_string(s, 36); }
     color_string white  (const std::string_view s) { return color_string(s, 37); }
+
+    // Example: zen::print(zen::color::views::red("FAIL"));
+    namespace views {
+        constexpr color_view nocolor(const std::string_view s) { return color_view(s,  0); }
+        constexpr color_view red    (const std::string_view s) { return color_view(s, 31); }
+        constexpr color_view blue   (const std::string_view s) { return color_view(s, 34); }
+        constexpr color_view green  (const std::string_view s) { return color_view(s, 32); }
+        constexpr color_view black  (const std::string_view s) { return color_view(s, 30); }
+        constexpr color_view yellow (const std::string_view s) { return color_view(s, 33); }
+        constexpr color_view magenta(const std::string_view s) { return color_view(s, 35); }
+        constexpr color_view cyan   (const std::string_view s) { return color_view(s, 36); }
+        constexpr color_view white  (const std::string_view s) { return color_view(s, 37); }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////// FILESYSTEM
@@ -345,6 +591,155 @@ search_downward(std::string_view name, std::filesystem::path from = std::filesys
     return std::nullopt;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////// zen::arena
+//
+// A monotonic memory resource: allocation bumps a pointer through large blocks,
+// deallocation does nothing, and the memory comes back all at once on reset()
+// (which keeps the blocks for reuse) or release() (which returns them). Every
+// allocation starts on a cache line, so objects from the arena never share one
+// with a neighbor that another thread writes. Blocks can be backed by huge pages,
+// which saves TLB misses on large working sets. Not thread-safe.
+// Example: zen::arena arena;
+//          zen::pmr::vector<int> v(&arena);
+//          ...
+//          zen::log(arena.stats().peak, "bytes at peak");
+
+// The instrumentation counters of zen::arena and zen::pool
+struct allocation_stats {
+    size_t bytes       = 0; // currently allocated
+    size_t peak        = 0; // the most ever allocated at once
+    size_t allocations = 0; // calls to allocate()
+
+    void on_allocate(size_t n)
+    {
+        bytes += n;
+        peak = std::max(peak, bytes);
+        ++allocations;
+    }
+
+    // Containers that outlive an arena's reset() still hand back memory that reset() has
+    // already taken off 'bytes', which can then only undercount, never wrap around
+    void on_deallocate(size_t n) { bytes -= std::min(bytes, n); }
+};
+
+class arena : public std::pmr::memory_resource
+{
+public:
+    enum class pages { normal, huge };
+
+    static constexpr size_t cache_line = 64;
+
+    explicit arena(size_t block_size = 1 << 20, pages backing = pages::normal)
+        : block_size_(block_size), backing_(backing) {}
+
+    arena(const arena&)            = delete;
+    arena& operator=(const arena&) = delete;
+
+    ~arena() override { release(); }
+
+    // Rewinds to the first block, keeping all blocks for the allocations to come
+    void reset()
+    {
+        current_ = 0;
+        cursor_  = blocks_.empty() ? nullptr : blocks_.front().data;
+        stats_.bytes = 0;
+    }
+
+    // Gives every block back to the system
+    void release()
+    {
+        for (const auto& b : blocks_)
+            free_block(b);
+        blocks_.clear();
+        current_ = 0;
+        cursor_  = nullptr;
+        stats_.bytes = 0;
+    }
+
+    const allocation_stats& stats() const { return stats_; }
+
+    // Bytes obtained from the system, in use or not
+    size_t reserved() const
+    {
+        size_t n = 0;
+        for (const auto& b : blocks_) n += b.size;
+        return n;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        alignment = std::max(alignment, cache_line);
+        for (;;) {
+            if (current_ < blocks_.size()) {
+                const block& b = blocks_[current_];
+                const uintptr_t p = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+                if (p + bytes <= reinterpret_cast<uintptr_t>(b.data) + b.size) {
+                    cursor_ = reinterpret_cast<std::byte*>(p + bytes);
+                    stats_.on_allocate(bytes);
+                    return reinterpret_cast<void*>(p);
+                }
+                if (++current_ < blocks_.size()) { // a block kept by reset()
+                    cursor_ = blocks_[current_].data;
+                    continue;
+                }
+            }
+            blocks_.push_back(allocate_block(std::max(block_size_, bytes + alignment)));
+            current_ = blocks_.size() - 1;
+            cursor_  = blocks_.back().data;
+        }
+    }
+
+    void do_deallocate(void*, size_t bytes, size_t) override { stats_.on_deallocate(bytes); }
+
+    bool do_is_equal(const std::pmr::memory_resource& x) const noexcept override { return this == &x; }
+
+private:
+    struct block {
+        std::byte* data;
+        size_t     size;
+        bool       mapped; // by mmap rather than operator new
+    };
+
+    block allocate_block(size_t size)
+    {
+#if defined(__linux__)
+        if (backing_ == pages::huge) {
+            constexpr size_t huge_page = 2 << 20;
+            size = (size + huge_page - 1) & ~(huge_page - 1);
+            // Reserved huge pages first, then transparent ones if none are reserved
+            void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p == MAP_FAILED) {
+                p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED)
+                    throw std::bad_alloc();
+                ::madvise(p, size, MADV_HUGEPAGE);
+            }
+            return {static_cast<std::byte*>(p), size, true};
+        }
+#endif
+        return {static_cast<std::byte*>(::operator new(size, std::align_val_t(cache_line))), size, false};
+    }
+
+    static void free_block(const block& b)
+    {
+#if defined(__linux__)
+        if (b.mapped) {
+            ::munmap(b.data, b.size);
+            return;
+        }
+#endif
+        ::operator delete(b.data, std::align_val_t(cache_line));
+    }
+
+    size_t             block_size_;
+    pages              backing_;
+    std::vector<block> blocks_;
+    size_t             current_ = 0;       // the block being bumped through
+    std::byte*         cursor_  = nullptr; // the first free byte in it
+    allocation_stats   stats_;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////// zen::array
 
 template<class T, size_t N>
@@ -695,6 +1090,50 @@ private:
     template <class T> constexpr bool is_equality_comparable_v = is_equality_comparable<T>::value;
 #endif
 
+// ------------------------------------------------------------------------------------------ Hashable
+
+#if __cpp_concepts >= 202002L
+    // Check if a type has a usable std::hash specialization
+    template <class T>
+    concept Hashable = requires(const T& x) {
+        { std::hash<T>{}(x) } -> std::convertible_to<size_t>; // can be hashed using std::hash
+    };
+    template <class T> concept is_hashable_v = Hashable<T>;
+#else // use SFINAE if concepts are not available (pre-C++20)
+    template <class T, class = void> struct is_hashable : std::false_type {};
+
+    template <class T>
+    struct is_hashable<T,
+        std::void_t<
+            decltype(std::hash<T>{}(std::declval<const T&>())) // can be hashed using std::hash
+        >
+    > : std::true_type {};
+
+    template <class T> constexpr bool is_hashable_v = is_hashable<T>::value;
+#endif
+
+// ------------------------------------------------------------------------------------------ LessThanComparable
+
+#if __cpp_concepts >= 202002L
+    // Check if a type can be ordered with <
+    template <class T>
+    concept LessThanComparable = requires(const T& x, const T& y) {
+        { x < y } -> std::convertible_to<bool>; // can be compared using <
+    };
+    template <class T> concept is_less_than_comparable_v = LessThanComparable<T>;
+#else // use SFINAE if concepts are not available (pre-C++20)
+    template <class T, class = void> struct is_less_than_comparable : std::false_type {};
+
+    template <class T>
+    struct is_less_than_comparable<T,
+        std::void_t<
+            decltype(std::declval<const T&>() < std::declval<const T&>()) // can be compared using <
+        >
+    > : std::true_type {};
+
+    template <class T> constexpr bool is_less_than_comparable_v = is_less_than_comparable<T>::value;
+#endif
+
 // ------------------------------------------------------------------------------------------ is_string_like
 
 template<class T>
@@ -703,1436 +1142,6722 @@ constexpr bool is_string_like() {
         || std::is_convertible<T, const char*>::value;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::deque
+// ------------------------------------------------------------------------------------------ ContiguousArithmetic
 
-template<class T, class A = std::allocator<T>>
-class deque : public std::deque<T, A>, private zen::stackonly
-{
-public:
-    using std::deque<T, A>::deque; // inherit constructors, has to be explicit
+#if __cpp_concepts >= 202002L
+    // Check if a type stores arithmetic elements contiguously (std::vector, std::array, C arrays, etc.)
+    template <class T>
+    concept ContiguousArithmetic = requires(const T& x) {
+        std::data(x); // has contiguous storage
+        std::size(x); // of known size
+    } && std::is_arithmetic_v<std::remove_cvref_t<decltype(*std::data(std::declval<const T&>()))>>;
 
-    deque(const std::deque<T, A>& d) : std::deque<T, A>(d) {}
+    template <class T> concept is_contiguous_arithmetic_v = ContiguousArithmetic<T>;
+#else // use SFINAE if concepts are not available (pre-C++20)
+    template <class T, class = void> struct is_contiguous_arithmetic : std::false_type {};
 
-    template<class Pred>
-    typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
-         contains(Pred p) const
-    {
-        return std::find_if(my::begin(), my::end(), p) != my::end();
-    }
-    bool contains(const T& x) const { return std::find(my::begin(), my::end(), x) != my::end(); }
+    template <class T>
+    struct is_contiguous_arithmetic<T,
+        std::void_t<
+            decltype(std::data(std::declval<const T&>())), // has contiguous storage
+            decltype(std::size(std::declval<const T&>()))  // of known size
+        >
+    > : std::is_arithmetic<std::remove_cv_t<std::remove_reference_t<decltype(*std::data(std::declval<const T&>()))>>> {};
 
-    bool is_empty() const { return my::empty(); }
+    template <class T> constexpr bool is_contiguous_arithmetic_v = is_contiguous_arithmetic<T>::value;
+#endif
 
-private:
-    using my = deque<T, A>;
+///////////////////////////////////////////////////////////////////////////////////////////// SIMD
+//
+// Vectorized kernels behind the contiguous-memory fast paths of the zen algorithms.
+// The kernels are compiled for their instruction set through target attributes,
+// independently of the flags the including project uses, and chosen at run time
+// from what the CPU supports. Every kernel first peels scalar elements off the
+// front until the pointer is aligned to the vector width, so that the loads of
+// the main loop never split a cache line. The loads themselves are unaligned
+// ones, which cost nothing extra on aligned addresses and keep the kernels safe
+// on pointers that can't be aligned at all (a double at an odd address).
+
+namespace internal::simd {
+
+struct cpu_features {
+    bool avx2     = false;
+    bool avx512f  = false;
+    bool avx512bw = false;
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::deref
+inline cpu_features detect_cpu()
+{
+    cpu_features f;
+#if ZEN_SIMD_X86 && defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    const int max_leaf = r[0];
+    __cpuid(r, 1);
+    const bool osxsave = r[2] & (1 << 27);
+    const bool avx     = r[2] & (1 << 28);
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool ymm = (xcr0 & 0x06) == 0x06; // OS saves the YMM state
+    const bool zmm = (xcr0 & 0xE6) == 0xE6; // OS saves the ZMM and opmask state
+    if (max_leaf >= 7) {
+        __cpuidex(r, 7, 0);
+        f.avx2     = avx && ymm && (r[1] & (1 << 5));
+        f.avx512f  = zmm && (r[1] & (1 << 16));
+        f.avx512bw = f.avx512f && (r[1] & (1 << 30));
+    }
+#elif ZEN_SIMD_X86
+    __builtin_cpu_init();
+    f.avx2     = __builtin_cpu_supports("avx2");
+    f.avx512f  = __builtin_cpu_supports("avx512f");
+    f.avx512bw = __builtin_cpu_supports("avx512bw");
+#endif
+    return f;
+}
 
-namespace internal {
+// Detected once, on first use
+inline const cpu_features& cpu()
+{
+    static const cpu_features f = detect_cpu();
+    return f;
+}
 
-// Base case: stop dereferencing
-template <typename T, typename = void>
-struct deref_recursive {
-    static T& deref(T& x) { return x; }
-};
+// Number of leading elements to process one by one until p is aligned to 'alignment'
+template<class T>
+size_t peel(const T* p, size_t n, size_t alignment)
+{
+    const size_t misalignment = reinterpret_cast<uintptr_t>(p) % alignment;
+    if (misalignment == 0 || misalignment % sizeof(T) != 0)
+        return 0; // already aligned, or can never be (under-aligned element type)
+    return std::min(n, (alignment - misalignment) / sizeof(T));
+}
 
-// Recursive case: continue dereferencing
-template <typename T>
-struct deref_recursive<T, std::void_t<decltype(*std::declval<T&>())>> {
-    static auto deref(T& x) -> decltype(deref_recursive<std::remove_reference_t<decltype(*x)>>::deref(*x)) {
-        return                          deref_recursive<std::remove_reference_t<decltype(*x)>>::deref(*x);
-    }
-};
+// ------------------------------------------------------------------------------------------ sum
 
-} // namespace internal
+// The element types with a vectorized sum. Integers wrap around on overflow, as the
+// hardware does; floating-point sums are reassociated across lanes and accumulators,
+// so they can differ from a sequential loop in the last bits.
+template<class T>
+constexpr bool is_summable_v = std::is_same_v<T, double> || std::is_same_v<T, float>
+    || (std::is_integral_v<T> && !std::is_same_v<T, bool> && (sizeof(T) == 4 || sizeof(T) == 8));
 
-// Main deref function
-template <typename T>
-auto deref(T& x) -> decltype(internal::deref_recursive<T>::deref(x)) {
-    return                   internal::deref_recursive<T>::deref(x);
+#if ZEN_SIMD_X86
+
+ZEN_TARGET("avx2")
+inline double sum_avx2(const double* p, size_t n, bool peel_head = true)
+{
+    double head = 0;
+    size_t i = 0;
+    for (const size_t k = peel_head ? peel(p, n, 32) : 0; i < k; ++i) head += p[i];
+
+    // Four independent accumulators hide the latency of the dependent additions
+    __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+    __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(p + i));
+        a1 = _mm256_add_pd(a1, _mm256_loadu_pd(p + i +  4));
+        a2 = _mm256_add_pd(a2, _mm256_loadu_pd(p + i +  8));
+        a3 = _mm256_add_pd(a3, _mm256_loadu_pd(p + i + 12));
+    }
+    for (; i + 4 <= n; i += 4)
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(p + i));
+    const __m256d a = _mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3));
+    const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+    double total = head + _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+    for (; i < n; ++i) total += p[i];
+    return total;
 }
 
-// Forward declarations
-std::string quote(const std::string_view s);
+ZEN_TARGET("avx512f")
+inline double sum_avx512(const double* p, size_t n, bool peel_head = true)
+{
+    double head = 0;
+    size_t i = 0;
+    for (const size_t k = peel_head ? peel(p, n, 64) : 0; i < k; ++i) head += p[i];
+
+    __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+    __m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm512_add_pd(a0, _mm512_loadu_pd(p + i));
+        a1 = _mm512_add_pd(a1, _mm512_loadu_pd(p + i +  8));
+        a2 = _mm512_add_pd(a2, _mm512_loadu_pd(p + i + 16));
+        a3 = _mm512_add_pd(a3, _mm512_loadu_pd(p + i + 24));
+    }
+    if (i < n) { // the masked load handles the whole tail in one go
+        for (; i + 8 <= n; i += 8)
+            a0 = _mm512_add_pd(a0, _mm512_loadu_pd(p + i));
+        const __mmask8 m = static_cast<__mmask8>((1u << (n - i)) - 1);
+        a1 = _mm512_add_pd(a1, _mm512_maskz_loadu_pd(m, p + i));
+    }
+    // Reduced through memory, GCC's _mm512_reduce_add_pd trips -Wuninitialized
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, _mm512_add_pd(_mm512_add_pd(a0, a1), _mm512_add_pd(a2, a3)));
+    return head + (((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7])));
+}
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::file
+ZEN_TARGET("avx2")
+inline float sum_avx2(const float* p, size_t n, bool peel_head = true)
+{
+    float head = 0;
+    size_t i = 0;
+    for (const size_t k = peel_head ? peel(p, n, 32) : 0; i < k; ++i) head += p[i];
+
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm256_add_ps(a0, _mm256_loadu_ps(p + i));
+        a1 = _mm256_add_ps(a1, _mm256_loadu_ps(p + i +  8));
+        a2 = _mm256_add_ps(a2, _mm256_loadu_ps(p + i + 16));
+        a3 = _mm256_add_ps(a3, _mm256_loadu_ps(p + i + 24));
+    }
+    for (; i + 8 <= n; i += 8)
+        a0 = _mm256_add_ps(a0, _mm256_loadu_ps(p + i));
+    const __m256 a = _mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3));
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+    float total = head + _mm_cvtss_f32(h);
+    for (; i < n; ++i) total += p[i];
+    return total;
+}
 
-class file : public std::fstream {
-public:
-    file(const std::filesystem::path& path)
-        : std::fstream(path), filepath_(path)
-    {
-        if (!my::is_open()) {
-            throw std::runtime_error("ERROR OPENING FILE: " + zen::quote(path.string()));
-        }
+ZEN_TARGET("avx512f")
+inline float sum_avx512(const float* p, size_t n, bool peel_head = true)
+{
+    float head = 0;
+    size_t i = 0;
+    for (const size_t k = peel_head ? peel(p, n, 64) : 0; i < k; ++i) head += p[i];
+
+    __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+    __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+    for (; i + 64 <= n; i += 64) {
+        a0 = _mm512_add_ps(a0, _mm512_loadu_ps(p + i));
+        a1 = _mm512_add_ps(a1, _mm512_loadu_ps(p + i + 16));
+        a2 = _mm512_add_ps(a2, _mm512_loadu_ps(p + i + 32));
+        a3 = _mm512_add_ps(a3, _mm512_loadu_ps(p + i + 48));
+    }
+    if (i < n) {
+        for (; i + 16 <= n; i += 16)
+            a0 = _mm512_add_ps(a0, _mm512_loadu_ps(p + i));
+        const __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        a1 = _mm512_add_ps(a1, _mm512_maskz_loadu_ps(m, p + i));
     }
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, _mm512_add_ps(_mm512_add_ps(a0, a1), _mm512_add_ps(a2, a3)));
+    float total = 0;
+    for (float x : lanes) total += x;
+    return head + total;
+}
 
-    ~file() {
-        if (my::is_open()) {
-            my::close();
-        }
+// Integer addition is associative, so 32- and 64-bit integers of either signedness share a kernel
+template<class T>
+ZEN_TARGET("avx2")
+T sum_int_avx2(const T* p, size_t n, bool peel_head = true)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+    using U = std::make_unsigned_t<T>; // wraps around instead of overflowing
+    U head = 0;
+    size_t i = 0;
+    for (const size_t k = peel_head ? peel(p, n, 32) : 0; i < k; ++i) head += static_cast<U>(p[i]);
+
+    constexpr size_t lanes = 32 / sizeof(T);
+    __m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+    for (; i + 2 * lanes <= n; i += 2 * lanes) {
+        const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + lanes));
+        if constexpr (sizeof(T) == 4) { a0 = _mm256_add_epi32(a0, v0); a1 = _mm256_add_epi32(a1, v1); }
+        else                          { a0 = _mm256_add_epi64(a0, v0); a1 = _mm256_add_epi64(a1, v1); }
+    }
+    for (; i + lanes <= n; i += lanes) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        if constexpr (sizeof(T) == 4) a0 = _mm256_add_epi32(a0, v);
+        else                          a0 = _mm256_add_epi64(a0, v);
     }
+    if constexpr (sizeof(T) == 4) a0 = _mm256_add_epi32(a0, a1);
+    else                          a0 = _mm256_add_epi64(a0, a1);
+
+    alignas(32) U partial[lanes];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(partial), a0);
+    U total = head;
+    for (U x : partial) total += x;
+    for (; i < n; ++i) total += static_cast<U>(p[i]);
+    return static_cast<T>(total);
+}
 
-    class iterator {
-    public:
-        iterator(file& is, bool end_marker = false)
-            : input_{ is }, end_marker_{ end_marker }
-        {
-            if (!end_marker_) {
-                input_.clear();
-                input_.seekg(0, std::ios::beg);
-                this->operator++();
-            }
-        }
+#endif // ZEN_SIMD_X86
 
-        bool operator!=(const iterator& it) const {
-            return it.end_marker_ != end_marker_;
-        }
+// Picks the widest kernel the CPU supports, with a plain loop as the last resort.
+// Without peel_head, which elements meet in which accumulator depends on their
+// index only, so the same values sum to the same floating-point result at any
+// address (a sub-span, another allocator), at the cost of loads that may split
+// cache lines.
+template<class T>
+T sum(const T* p, size_t n, bool peel_head = true)
+{
+    static_assert(is_summable_v<T>);
+#if ZEN_SIMD_X86
+    if constexpr (std::is_floating_point_v<T>) {
+        if (cpu().avx512f) return sum_avx512(p, n, peel_head);
+        if (cpu().avx2)    return sum_avx2(  p, n, peel_head);
+    } else {
+        if (cpu().avx2)    return sum_int_avx2(p, n, peel_head);
+    }
+#endif
+    T total{};
+    for (size_t i = 0; i < n; ++i) total += p[i];
+    return total;
+}
 
-        const std::string& operator*() const {
-            return line_;
-        }
+// ------------------------------------------------------------------------------------------ count
 
-        iterator& operator++() {
-            if (input_.eof())
-                end_marker_ = true;
-            else
-                std::getline(input_, line_, '\n');
+// The comparisons count() and count_if() know how to vectorize
+enum class compare_op { eq, ne, lt, le, gt, ge };
 
-            return *this;
-        }
+template<compare_op Op, class A, class B>
+constexpr bool compare(const A& a, const B& b)
+{
+    if constexpr (Op == compare_op::eq) return a == b;
+    if constexpr (Op == compare_op::ne) return a != b;
+    if constexpr (Op == compare_op::lt) return a <  b;
+    if constexpr (Op == compare_op::le) return a <= b;
+    if constexpr (Op == compare_op::gt) return a >  b;
+    if constexpr (Op == compare_op::ge) return a >= b;
+}
 
-    private:
-        file&        input_;
-        bool         end_marker_{ false };
-        std::string  line_;
-    };
+// The element types with a vectorized count: float, double and integers of up to 64 bits
+template<class T>
+constexpr bool is_countable_v = std::is_same_v<T, double> || std::is_same_v<T, float>
+    || (std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 8);
 
-    auto begin() { return iterator{ *this }; }
-    auto end()   { return iterator{ *this, true }; }
+#if ZEN_SIMD_X86
 
-    std::string getline(int nth)
-    {
-        auto it = begin();
-        while (--nth > 0 && it != end()) {
-            ++it;
+// Ordered, non-signaling predicates, so that NaN compares like it does in scalar code:
+// false for everything but !=
+template<compare_op Op>
+constexpr int float_predicate()
+{
+    if constexpr (Op == compare_op::eq) return _CMP_EQ_OQ;
+    if constexpr (Op == compare_op::ne) return _CMP_NEQ_UQ;
+    if constexpr (Op == compare_op::lt) return _CMP_LT_OQ;
+    if constexpr (Op == compare_op::le) return _CMP_LE_OQ;
+    if constexpr (Op == compare_op::gt) return _CMP_GT_OQ;
+    if constexpr (Op == compare_op::ge) return _CMP_GE_OQ;
+}
+
+template<compare_op Op>
+constexpr int int_predicate()
+{
+    if constexpr (Op == compare_op::eq) return _MM_CMPINT_EQ;
+    if constexpr (Op == compare_op::ne) return _MM_CMPINT_NE;
+    if constexpr (Op == compare_op::lt) return _MM_CMPINT_LT;
+    if constexpr (Op == compare_op::le) return _MM_CMPINT_LE;
+    if constexpr (Op == compare_op::gt) return _MM_CMPINT_NLE;
+    if constexpr (Op == compare_op::ge) return _MM_CMPINT_NLT;
+}
+
+// As variables, since without optimization the compare intrinsics are macros that
+// need their predicate as an immediate, which a function call doesn't give them
+template<compare_op Op> constexpr int float_predicate_v = float_predicate<Op>();
+template<compare_op Op> constexpr int int_predicate_v   = int_predicate<Op>();
+
+template<class T>
+ZEN_TARGET("avx2")
+inline __m256i broadcast_avx2(T x)
+{
+    if constexpr (sizeof(T) == 1) return _mm256_set1_epi8(  static_cast<char>(x));
+    if constexpr (sizeof(T) == 2) return _mm256_set1_epi16( static_cast<short>(x));
+    if constexpr (sizeof(T) == 4) return _mm256_set1_epi32( static_cast<int>(x));
+    if constexpr (sizeof(T) == 8) return _mm256_set1_epi64x(static_cast<long long>(x));
+}
+
+template<class T>
+ZEN_TARGET("avx2")
+inline __m256i cmpeq_avx2(__m256i a, __m256i b)
+{
+    if constexpr (sizeof(T) == 1) return _mm256_cmpeq_epi8( a, b);
+    if constexpr (sizeof(T) == 2) return _mm256_cmpeq_epi16(a, b);
+    if constexpr (sizeof(T) == 4) return _mm256_cmpeq_epi32(a, b);
+    if constexpr (sizeof(T) == 8) return _mm256_cmpeq_epi64(a, b);
+}
+
+template<class T>
+ZEN_TARGET("avx2")
+inline __m256i cmpgt_avx2(__m256i a, __m256i b) // signed
+{
+    if constexpr (sizeof(T) == 1) return _mm256_cmpgt_epi8( a, b);
+    if constexpr (sizeof(T) == 2) return _mm256_cmpgt_epi16(a, b);
+    if constexpr (sizeof(T) == 4) return _mm256_cmpgt_epi32(a, b);
+    if constexpr (sizeof(T) == 8) return _mm256_cmpgt_epi64(a, b);
+}
+
+// Each vector compare yields a lane mask that movemask squeezes into one bit
+// per lane (per byte for integers) and popcount turns into a count
+template<compare_op Op, class T>
+ZEN_TARGET("avx2,popcnt")
+size_t count_avx2(const T* p, size_t n, T x)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (const size_t k = peel(p, n, 32); i < k; ++i) count += compare<Op>(p[i], x);
+
+    constexpr size_t lanes = 32 / sizeof(T);
+    if constexpr (std::is_same_v<T, double>) {
+        const __m256d xv = _mm256_set1_pd(x);
+        for (; i + lanes <= n; i += lanes) {
+            const __m256d m = _mm256_cmp_pd(_mm256_loadu_pd(p + i), xv, float_predicate_v<Op>);
+            count += _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_pd(m)));
+        }
+    } else if constexpr (std::is_same_v<T, float>) {
+        const __m256 xv = _mm256_set1_ps(x);
+        for (; i + lanes <= n; i += lanes) {
+            const __m256 m = _mm256_cmp_ps(_mm256_loadu_ps(p + i), xv, float_predicate_v<Op>);
+            count += _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_ps(m)));
+        }
+    } else {
+        // AVX2 only compares signed integers, unsigned ones are flipped into signed order
+        const __m256i bias = std::is_signed_v<T> ? _mm256_setzero_si256()
+                                                 : broadcast_avx2(static_cast<T>(T(1) << (8 * sizeof(T) - 1)));
+        const __m256i xv = _mm256_xor_si256(broadcast_avx2(x), bias);
+        for (; i + lanes <= n; i += lanes) {
+            const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), bias);
+            __m256i m;
+            if constexpr (Op == compare_op::eq || Op == compare_op::ne) m = cmpeq_avx2<T>(v, xv);
+            if constexpr (Op == compare_op::gt || Op == compare_op::le) m = cmpgt_avx2<T>(v, xv);
+            if constexpr (Op == compare_op::lt || Op == compare_op::ge) m = cmpgt_avx2<T>(xv, v);
+            unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(m));
+            if constexpr (Op == compare_op::ne || Op == compare_op::le || Op == compare_op::ge)
+                bits = ~bits; // the complement of ==, > and <
+            count += _mm_popcnt_u32(bits) / sizeof(T); // sizeof(T) mask bits per lane
         }
+    }
 
-        if (nth != 0)
-            throw std::out_of_range("REACHED END OF FILE: " + zen::quote(filepath_.string()));
+    for (; i < n; ++i) count += compare<Op>(p[i], x);
+    return count;
+}
 
-        return *it;
+// AVX-512 compares straight into mask registers, in any order and signedness
+template<compare_op Op, class T>
+ZEN_TARGET("avx512f,popcnt")
+size_t count_avx512(const T* p, size_t n, T x)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8); // 8- and 16-bit lanes would need AVX-512BW
+    size_t count = 0;
+    size_t i = 0;
+    for (const size_t k = peel(p, n, 64); i < k; ++i) count += compare<Op>(p[i], x);
+
+    constexpr size_t lanes = 64 / sizeof(T);
+    for (; i < n; i += lanes) {
+        // The last iteration masks off the lanes past the end instead of looping over a scalar tail
+        const unsigned valid = n - i >= lanes ? ~0u : (1u << (n - i)) - 1;
+        unsigned m;
+        if constexpr (std::is_same_v<T, double>) {
+            const __m512d v = _mm512_maskz_loadu_pd(static_cast<__mmask8>(valid), p + i);
+            m = _mm512_mask_cmp_pd_mask(static_cast<__mmask8>(valid), v, _mm512_set1_pd(x), float_predicate_v<Op>);
+        } else if constexpr (std::is_same_v<T, float>) {
+            const __m512 v = _mm512_maskz_loadu_ps(static_cast<__mmask16>(valid), p + i);
+            m = _mm512_mask_cmp_ps_mask(static_cast<__mmask16>(valid), v, _mm512_set1_ps(x), float_predicate_v<Op>);
+        } else if constexpr (sizeof(T) == 4) {
+            const __m512i v  = _mm512_maskz_loadu_epi32(static_cast<__mmask16>(valid), p + i);
+            const __m512i xv = _mm512_set1_epi32(static_cast<int>(x));
+            if constexpr (std::is_signed_v<T>) m = _mm512_mask_cmp_epi32_mask(static_cast<__mmask16>(valid), v, xv, int_predicate_v<Op>);
+            else                               m = _mm512_mask_cmp_epu32_mask(static_cast<__mmask16>(valid), v, xv, int_predicate_v<Op>);
+        } else {
+            const __m512i v  = _mm512_maskz_loadu_epi64(static_cast<__mmask8>(valid), p + i);
+            const __m512i xv = _mm512_set1_epi64(static_cast<long long>(x));
+            if constexpr (std::is_signed_v<T>) m = _mm512_mask_cmp_epi64_mask(static_cast<__mmask8>(valid), v, xv, int_predicate_v<Op>);
+            else                               m = _mm512_mask_cmp_epu64_mask(static_cast<__mmask8>(valid), v, xv, int_predicate_v<Op>);
+        }
+        count += _mm_popcnt_u32(m);
     }
+    return count;
+}
 
-private:
-    // TODO: Dynamically cache lines that are read the first time?
-    const std::filesystem::path& filepath_;
+#endif // ZEN_SIMD_X86
 
-    using my = std::fstream;
-};
+// Counts the elements e of [p, p + n) for which (e Op x) holds
+template<compare_op Op, class T>
+size_t count(const T* p, size_t n, T x)
+{
+    static_assert(is_countable_v<T>);
+#if ZEN_SIMD_X86
+    if constexpr (sizeof(T) >= 4) {
+        if (cpu().avx512f) return count_avx512<Op>(p, n, x);
+    }
+    if (cpu().avx2) return count_avx2<Op>(p, n, x);
+#endif
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += compare<Op>(p[i], x);
+    return count;
+}
 
-namespace literals::path {
+// ------------------------------------------------------------------------------------------ contains
 
-std::filesystem::path operator ""_path(const char* str, std::size_t length)
+#if ZEN_SIMD_X86
+
+// All bits set in the lanes of the 32 bytes at p that are equal to x
+template<class T>
+ZEN_TARGET("avx2")
+inline __m256i equal_lanes_avx2(const T* p, T x)
 {
-    return std::filesystem::path(std::string(str, length));
+    if constexpr (std::is_same_v<T, double>)
+        return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_set1_pd(x), _CMP_EQ_OQ));
+    else if constexpr (std::is_same_v<T, float>)
+        return _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(p), _mm256_set1_ps(x), _CMP_EQ_OQ));
+    else
+        return cmpeq_avx2<T>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), broadcast_avx2(x));
 }
 
-} // namespace literals::path
+// Stops at the first match. Two vectors are compared per iteration and
+// tested together, so there's a single branch per 64 bytes.
+template<class T>
+ZEN_TARGET("avx2")
+bool contains_avx2(const T* p, size_t n, T x)
+{
+    size_t i = 0;
+    for (const size_t k = peel(p, n, 32); i < k; ++i)
+        if (p[i] == x) return true;
+
+    constexpr size_t lanes = 32 / sizeof(T);
+    for (; i + 2 * lanes <= n; i += 2 * lanes) {
+        const __m256i m = _mm256_or_si256(equal_lanes_avx2(p + i, x), equal_lanes_avx2(p + i + lanes, x));
+        if (!_mm256_testz_si256(m, m)) return true;
+    }
+    for (; i < n; ++i)
+        if (p[i] == x) return true;
+    return false;
+}
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::forward_list
+#endif // ZEN_SIMD_X86
 
-template<class T, class A = std::allocator<T>>
-class forward_list : public std::forward_list<T, A>, private zen::stackonly
+// Whether x is among the n elements at p
+template<class T>
+bool contains(const T* p, size_t n, T x)
 {
-public:
-    using std::forward_list<T, A>::forward_list; // inherit constructors, has to be explicit
+    static_assert(is_countable_v<T>);
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return contains_avx2(p, n, x);
+#endif
+    return std::find(p, p + n, x) != p + n;
+}
 
-    forward_list(const std::forward_list<T, A>& x) : std::forward_list<T, A>(x) {}
+} // namespace internal::simd
 
-    template<class Pred>
-    typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
-        contains(Pred p) const
-    {
-        return std::find_if(my::begin(), my::end(), p) != my::end();
-    }
-    bool contains(const T& x) const { return std::find(my::begin(), my::end(), x) != my::end(); }
+///////////////////////////////////////////////////////////////////////////////////////////// PARALLEL
+//
+// Execution policies for the parallel overloads of the zen algorithms.
+// These are zen's own, since on some standard libraries <execution> drags
+// in TBB and a link dependency on it. The standard policies are accepted
+// as well when ZEN_STD_EXECUTION is defined before including kaizen.h.
+// Example: zen::sum(zen::execution::par,    v); // one thread per hardware thread
+//          zen::sum(zen::execution::par(4), v); // four threads
+//          zen::sum(std::execution::par,    v); // with ZEN_STD_EXECUTION
 
-    bool is_empty() const { return my::empty(); }
+namespace execution {
 
-private:
-    using my = forward_list<T, A>;
+struct sequenced_policy {};
+
+struct parallel_policy {
+    unsigned threads = 0; // 0 means one per hardware thread
+
+    constexpr parallel_policy operator()(unsigned n) const { return parallel_policy{n}; }
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::in
+inline constexpr sequenced_policy seq{};
+inline constexpr parallel_policy  par{};
 
-// Declarative range-for loop. Note that apart from an intuitive
-// reading, "in" can also be thought of standing for "interval".
-// Example: for (int i : zen::in(5))         // from  0 to  5
-// Example: for (int i : zen::in(1, 10))     // from  1 to 10
-// Example: for (int i : zen::in(10, 1, -1)) // from 10 to  1, step -1
-class in {
-public:
-    in(int end)
-        : begin_(0), end_(end), step_(1) {}
+template<class T>
+constexpr bool is_parallel_policy_v = std::is_same_v<std::remove_cvref_t<T>, parallel_policy>
+#if defined(ZEN_STD_EXECUTION)
+                                   || std::is_same_v<std::remove_cvref_t<T>, std::execution::parallel_policy>
+                                   || std::is_same_v<std::remove_cvref_t<T>, std::execution::parallel_unsequenced_policy>
+#endif
+                                   ;
 
-    in(int begin, int end, int step = 1)
-        : begin_(begin), end_(end), step_(step) {}
+template<class T>
+constexpr bool is_execution_policy_v = is_parallel_policy_v<T>
+#if defined(ZEN_STD_EXECUTION)
+                                    || std::is_execution_policy_v<std::remove_cvref_t<T>>
+#endif
+                                    || std::is_same_v<std::remove_cvref_t<T>, sequenced_policy>;
 
-    class iterator {
-    public:
-        iterator(int n = 0, int step = 1) : n_(n), step_(step) {}
-        iterator& operator++() { n_ += step_; return *this; }
-        const int& operator*()             const { return n_; }
-        bool operator!=(const iterator& x) const {
-            return (step_ > 0) ? (n_ < x.n_) : (n_ > x.n_);
+} // namespace execution
+
+namespace internal {
+
+// The standard parallel policies carry no thread count, so they get one per hardware thread
+template<class ExecutionPolicy>
+constexpr execution::parallel_policy as_parallel(const ExecutionPolicy& policy)
+{
+    if constexpr (std::is_same_v<ExecutionPolicy, execution::parallel_policy>)
+        return policy;
+    else
+        return execution::parallel_policy{};
+}
+
+// Ranges smaller than this aren't worth starting threads for
+constexpr size_t parallel_min_bytes = 1 << 20;
+
+// Cuts [0, n) into blocks of 'block' elements, after a first one of 'head' elements,
+// runs f(begin, end) over the blocks on up to 'threads' threads and returns the result
+// of every block in block order. Since neither the blocks nor the order of their
+// results depend on the thread count or on scheduling, combining the results in
+// order gives the same answer on every run, floating-point sums included.
+template<class R, class F>
+std::vector<R> parallel_blocks(size_t n, size_t head, size_t block, unsigned threads, F f)
+{
+    std::vector<size_t> bounds{0};
+    if (head > 0)
+        bounds.push_back(std::min(n, head));
+    while (bounds.back() < n)
+        bounds.push_back(std::min(n, bounds.back() + block));
+
+    std::vector<R> results(bounds.size() - 1);
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, results.size()));
+
+    // Blocks are handed out one at a time, which balances uneven blocks and threads
+    std::atomic<size_t> next{0};
+    std::exception_ptr  error;
+    std::mutex          error_mutex;
+    auto work = [&] {
+        try {
+            for (size_t b; (b = next.fetch_add(1, std::memory_order_relaxed)) < results.size(); )
+                results[b] = f(bounds[b], bounds[b + 1]);
+        } catch (...) {
+            std::lock_guard lock(error_mutex);
+            if (!error) error = std::current_exception();
+            next = results.size(); // stop the others early
         }
-    private:
-        int n_;
-        int step_;
     };
 
-    iterator begin() const { return iterator(begin_, step_); }
-    iterator end()   const { return iterator(end_,   step_); }
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.push_back(test_aware_thread(work));
+    work(); // the calling thread is one of the workers
+    for (auto& t : pool)
+        t.join();
 
-private:
-    int begin_;
-    int end_;
-    int step_;
-};
+    if (error)
+        std::rethrow_exception(error);
+    return results;
+}
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::list
+// Blocks of 64 KiB worth of elements, starting at multiples of the block length.
+// They are anchored to element indices rather than to cache lines of the data, so
+// that the same values are cut the same way wherever they are in memory; at most
+// the one cache line around each block boundary is shared by two threads.
+template<class R, class Iterable, class F>
+std::vector<R> parallel_blocks(const Iterable& c, unsigned threads, F f)
+{
+    using T = std::remove_cvref_t<decltype(*std::begin(c))>;
+    return parallel_blocks<R>(std::size(c), 0, std::max<size_t>(1, (64 * 1024) / sizeof(T)), threads, f);
+}
+
+template<class Iterable>
+concept random_access_range = std::random_access_iterator<decltype(std::begin(std::declval<const Iterable&>()))>;
+
+// Whether the parallel overloads split c over threads: it has to be random-access
+// and large enough, and there have to be threads to split it over
+template<class Iterable>
+bool is_worth_parallel(const Iterable& c, execution::parallel_policy policy)
+{
+    if constexpr (random_access_range<Iterable>)
+        return policy.threads != 1 && std::size(c) * sizeof(*std::begin(c)) >= parallel_min_bytes;
+    else
+        return false;
+}
+
+// Backs the parallel contains() of the container wrappers; x is either a value or a predicate
+template<class Iterable, class X>
+bool parallel_contains(execution::parallel_policy policy, const Iterable& c, const X& x)
+{
+    auto matches = [&](const auto& e) -> bool {
+        if constexpr (std::is_invocable_r_v<bool, const X&, decltype(e)>)
+            return x(e);
+        else
+            return e == x;
+    };
+
+    if constexpr (random_access_range<Iterable>) {
+        if (is_worth_parallel(c, policy)) {
+            // A match anywhere settles it, so the blocks still to come are skipped
+            std::atomic<bool> found{false};
+            parallel_blocks<char>(c, policy.threads, [&](size_t begin, size_t end) -> char {
+                if (found.load(std::memory_order_relaxed))
+                    return 0;
+                const auto first = std::begin(c) + begin;
+                const auto last  = std::begin(c) + end;
+                if (std::find_if(first, last, matches) == last)
+                    return 0;
+                found.store(true, std::memory_order_relaxed);
+                return 1;
+            });
+            return found.load();
+        }
+    }
+    return std::find_if(std::begin(c), std::end(c), matches) != std::end(c);
+}
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::deque
 
 template<class T, class A = std::allocator<T>>
-class list : public std::list<T, A>, private zen::stackonly
+class deque : public std::deque<T, A>, private zen::stackonly
 {
 public:
-    using std::list<T, A>::list; // inherit constructors, has to be explicit
+    using std::deque<T, A>::deque; // inherit constructors, has to be explicit
 
-    list(const std::list<T, A>& x) : std::list<T, A>(x) {}
+    deque(const std::deque<T, A>& d) : std::deque<T, A>(d) {}
 
     template<class Pred>
     typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
-        contains(Pred p) const
+         contains(Pred p) const
     {
         return std::find_if(my::begin(), my::end(), p) != my::end();
     }
-    bool contains(const T& x) const { return std::find(my::begin(), my::end(), x) != my::end(); }
+    bool contains(const T& x) const
+    {
+        return std::find(my::begin(), my::end(), x) != my::end();
+    }
+
+    // Splits the search over threads when the container is large, see PARALLEL
+    // Example: v.contains(zen::execution::par, 42);
+    template<class ExecutionPolicy, class X>
+    typename std::enable_if<execution::is_execution_policy_v<ExecutionPolicy>, bool>::type
+        contains(ExecutionPolicy&& policy, const X& x) const
+    {
+        if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>)
+            return internal::parallel_contains(internal::as_parallel(policy), *this, x);
+        else
+            return contains(x);
+    }
 
     bool is_empty() const { return my::empty(); }
 
 private:
-    using my = list<T, A>;
+    using my = deque<T, A>;
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::map
-
-template<class K, class V, class C = std::less<K>, class A = std::allocator<std::pair<const K, V>>>
-class map : public std::map<K, V, C, A>, private zen::stackonly
-{
-public:
-    using std::map<K, V, C, A>::map; // inherit constructors, has to be explicit
-
-    map(const std::map<K, V, C, A>& m) : std::map<K, V, C, A>(m) {}
+///////////////////////////////////////////////////////////////////////////////////////////// zen::deref
 
-    template<class Kx, class Vx, class Cx, class Ax>
-    map(const std::map<Kx, Vx, Cx, Ax>& m) : std::map<K, V, C, A>(m.begin(), m.end()) {}
+namespace internal {
 
-    bool is_empty() const { return my::empty(); }
+// Base case: stop dereferencing
+template <typename T, typename = void>
+struct deref_recursive {
+    static T& deref(T& x) { return x; }
+};
 
-private:
-    using my = map<K, V, C, A>;
+// Recursive case: continue dereferencing
+template <typename T>
+struct deref_recursive<T, std::void_t<decltype(*std::declval<T&>())>> {
+    static auto deref(T& x) -> decltype(deref_recursive<std::remove_reference_t<decltype(*x)>>::deref(*x)) {
+        return                          deref_recursive<std::remove_reference_t<decltype(*x)>>::deref(*x);
+    }
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::multimap
+} // namespace internal
 
-template<class K, class V, class C = std::less<K>, class A = std::allocator<std::pair<const K, V>>>
-class multimap : public std::multimap<K, V, C, A>, private zen::stackonly
-{
-public:
-    using std::multimap<K, V, C, A>::multimap; // inherit constructors, has to be explicit
+// Main deref function
+template <typename T>
+auto deref(T& x) -> decltype(internal::deref_recursive<T>::deref(x)) {
+    return                   internal::deref_recursive<T>::deref(x);
+}
 
-    multimap(const std::multimap<K, V, C, A>& m) : std::multimap<K, V, C, A>(m) {}
+// Forward declarations
+std::string quote(const std::string_view s);
 
-    template<class Kx, class Vx, class Cx, class Ax>
-    multimap(const std::multimap<Kx, Vx, Cx, Ax>& m) : std::multimap<K, V, C, A>(m.begin(), m.end()) {}
+///////////////////////////////////////////////////////////////////////////////////////////// zen::file
 
-    // std::map::operator[] is not defined, but
-    // zen::map::operator[] returns an std::vector
-    // composed of values corresponding to the parameter key.
-    std::vector<V> operator[](const K& key) {
-        auto range = my::equal_range(key);
-        std::vector<V> values;
-        for (auto it = range.first; it != range.second; ++it) {
-            values.push_back(it->second);
+class file : public std::fstream {
+public:
+    file(const std::filesystem::path& path)
+        : std::fstream(path), filepath_(path)
+    {
+        if (!my::is_open()) {
+            throw std::runtime_error("ERROR OPENING FILE: " + zen::quote(path.string()));
         }
-        return values;
     }
 
-    bool is_empty() const { return my::empty(); }
+    ~file() {
+        if (my::is_open()) {
+            my::close();
+        }
+    }
 
-private:
-    using my = multimap<K, V, C, A>;
-};
+    class iterator {
+    public:
+        iterator(file& is, bool end_marker = false)
+            : input_{ is }, end_marker_{ end_marker }
+        {
+            if (!end_marker_) {
+                input_.clear();
+                input_.seekg(0, std::ios::beg);
+                this->operator++();
+            }
+        }
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::point2d
+        bool operator!=(const iterator& it) const {
+            return it.end_marker_ != end_marker_;
+        }
+
+        const std::string& operator*() const {
+            return line_;
+        }
+
+        iterator& operator++() {
+            if (input_.eof())
+                end_marker_ = true;
+            else
+                std::getline(input_, line_, '\n');
+
+            return *this;
+        }
+
+    private:
+        file&        input_;
+        bool         end_marker_{ false };
+        std::string  line_;
+    };
+
+    auto begin() { return iterator{ *this }; }
+    auto end()   { return iterator{ *this, true }; }
+
+    std::string getline(int nth)
+    {
+        auto it = begin();
+        while (--nth > 0 && it != end()) {
+            ++it;
+        }
+
+        if (nth != 0)
+            throw std::out_of_range("REACHED END OF FILE: " + zen::quote(filepath_.string()));
+
+        return *it;
+    }
+
+private:
+    // TODO: Dynamically cache lines that are read the first time?
+    const std::filesystem::path& filepath_;
+
+    using my = std::fstream;
+};
+
+namespace literals::path {
+
+std::filesystem::path operator ""_path(const char* str, std::size_t length)
+{
+    return std::filesystem::path(std::string(str, length));
+}
+
+} // namespace literals::path
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::flat_hash_map
+//
+// An open-addressing hash map, where zen::unordered_map allocates a node per element.
+// Elements live in one array of slots, next to an array of one control byte per slot
+// that holds 7 bits of the hash of a full slot, or marks it empty or deleted. Slots
+// are probed in groups of 16: a single SSE2 compare checks the control bytes of a
+// whole group against the hash bits of the key, and only the matching slots (rarely
+// more than one) get their keys compared. The table grows at a load of 7/8.
+// Keys are const, so growing the table copies them; reserve() up front avoids it.
+// Example: zen::flat_hash_map<std::string, int> m = {{"one", 1}, {"two", 2}};
+//          m["three"] = 3;
+//          m.contains("two"); // true
+
+template<
+    class K,
+    class V,
+    class H = std::hash<K>,
+    class E = std::equal_to<K>,
+    class A = std::allocator<std::pair<const K, V>>
+>
+class flat_hash_map : private zen::stackonly
+{
+    static constexpr size_t group_width = 16;
+
+    // A control byte is the 7 hash bits of a full slot, or one of these (negative) markers
+    static constexpr int8_t empty_slot   = -128;
+    static constexpr int8_t deleted_slot = -2;
+
+    struct alignas(group_width) group {
+        int8_t ctrl[group_width];
+
+        // Bit i is set if control byte i equals b
+        uint32_t match(int8_t b) const
+        {
+#if ZEN_SIMD_X86 // SSE2 is part of x86-64
+            const __m128i g = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(b))));
+#else
+            uint32_t m = 0;
+            for (size_t i = 0; i < group_width; ++i) m |= uint32_t(ctrl[i] == b) << i;
+            return m;
+#endif
+        }
+
+        // Bit i is set if slot i is empty or deleted, the markers being the only negative bytes
+        uint32_t match_free() const
+        {
+#if ZEN_SIMD_X86
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl))));
+#else
+            uint32_t m = 0;
+            for (size_t i = 0; i < group_width; ++i) m |= uint32_t(ctrl[i] < 0) << i;
+            return m;
+#endif
+        }
+    };
+
+    template<bool Const>
+    class basic_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = std::pair<const K, V>;
+        using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+
+        basic_iterator() = default;
+
+        operator basic_iterator<true>() const { return basic_iterator<true>(ctrl_, end_, slot_); }
+
+        reference operator*()  const { return *slot_; }
+        pointer   operator->() const { return  slot_; }
+
+        basic_iterator& operator++()    { ++ctrl_; ++slot_; skip_free(); return *this; }
+        basic_iterator  operator++(int) { auto it = *this; ++*this; return it; }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a.ctrl_ == b.ctrl_; }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) { return a.ctrl_ != b.ctrl_; }
+
+    private:
+        friend class flat_hash_map;
+        friend class basic_iterator<!Const>;
+
+        basic_iterator(const int8_t* ctrl, const int8_t* end, pointer slot) : ctrl_(ctrl), end_(end), slot_(slot) {}
+
+        void skip_free() { while (ctrl_ != end_ && *ctrl_ < 0) { ++ctrl_; ++slot_; } }
+
+        const int8_t* ctrl_ = nullptr;
+        const int8_t* end_  = nullptr;
+        pointer       slot_ = nullptr;
+    };
+
+    using slot_allocator  = typename std::allocator_traits<A>::template rebind_alloc<std::pair<const K, V>>;
+    using group_allocator = typename std::allocator_traits<A>::template rebind_alloc<group>;
+    using slot_traits     = std::allocator_traits<slot_allocator>;
+    using group_traits    = std::allocator_traits<group_allocator>;
 
-class point2d : public std::pair<double, double> {
 public:
-    point2d(double xc = 0.0, double yc = 0.0)    : std::pair<double, double>(xc, yc)       {}
-    point2d(const std::pair<double, double>&  p) : std::pair<double, double>(p)            {}
-    point2d(      std::pair<double, double>&& p) : std::pair<double, double>(std::move(p)) {}
+    using key_type        = K;
+    using mapped_type     = V;
+    using value_type      = std::pair<const K, V>;
+    using size_type       = size_t;
+    using hasher          = H;
+    using key_equal       = E;
+    using allocator_type  = A;
+    using iterator        = basic_iterator<false>;
+    using const_iterator  = basic_iterator<true>;
+
+    flat_hash_map() = default;
+
+    explicit flat_hash_map(const A& alloc) : slot_alloc_(alloc), group_alloc_(alloc) {}
+
+    template<class InputIt>
+    flat_hash_map(InputIt first, InputIt last, const A& alloc = A()) : flat_hash_map(alloc)
+    {
+        for (; first != last; ++first)
+            insert(*first);
+    }
 
-    // Allows conversions from other arithmetic pair types
-    template <class T, class U, typename std::enable_if<
-                                         std::is_arithmetic_v<T> &&
-                                         std::is_arithmetic_v<U>, int>::type = 0>
-    point2d(const std::pair<T, U>& p)
-        : std::pair<double, double>(
-            static_cast<double>(p.first),
-            static_cast<double>(p.second)
-        )
-    {}
+    flat_hash_map(std::initializer_list<value_type> init, const A& alloc = A()) : flat_hash_map(alloc)
+    {
+        reserve(init.size());
+        for (const auto& x : init)
+            insert(x);
+    }
 
-    point2d& operator=(const std::pair<double, double>& p) {
-        this->first  = p.first;
-        this->second = p.second;
+    // The allocator-extended constructors, which nested pmr containers construct their elements with
+    flat_hash_map(const flat_hash_map& x, const A& alloc)
+        : hash_(x.hash_), equal_(x.equal_), slot_alloc_(alloc), group_alloc_(alloc)
+    {
+        reserve(x.size());
+        for (const auto& e : x)
+            insert(e);
+    }
+
+    // Takes over the table if both allocators can free each other's memory, moves the elements over otherwise
+    flat_hash_map(flat_hash_map&& x, const A& alloc)
+        : hash_(x.hash_), equal_(x.equal_), slot_alloc_(alloc), group_alloc_(alloc)
+    {
+        if (slot_alloc_ == x.slot_alloc_)
+            take_table(x);
+        else
+            move_elements(x);
+    }
+
+    flat_hash_map(const flat_hash_map& x)
+        : hash_(x.hash_), equal_(x.equal_)
+        , slot_alloc_(slot_traits::select_on_container_copy_construction(x.slot_alloc_))
+        , group_alloc_(group_traits::select_on_container_copy_construction(x.group_alloc_))
+    {
+        reserve(x.size());
+        for (const auto& e : x)
+            insert(e);
+    }
+
+    flat_hash_map(flat_hash_map&& x) noexcept
+        : hash_(std::move(x.hash_)), equal_(std::move(x.equal_))
+        , slot_alloc_(std::move(x.slot_alloc_)), group_alloc_(std::move(x.group_alloc_))
+        , groups_(std::exchange(x.groups_, nullptr)), slots_(std::exchange(x.slots_, nullptr))
+        , capacity_(std::exchange(x.capacity_, 0)), size_(std::exchange(x.size_, 0))
+        , deleted_(std::exchange(x.deleted_, 0)) {}
+
+    // The allocators follow the propagate_on_container_* traits, like those of the std
+    // containers; std::pmr::polymorphic_allocator, for one, never leaves its container.
+    // Memory from an allocator that stays behind goes back to it before the other comes in.
+    flat_hash_map& operator=(const flat_hash_map& x)
+    {
+        if (this == &x)
+            return *this;
+        if constexpr (slot_traits::propagate_on_container_copy_assignment::value) {
+            if (slot_alloc_ != x.slot_alloc_)
+                destroy();
+            slot_alloc_  = x.slot_alloc_;
+            group_alloc_ = x.group_alloc_;
+        }
+        clear();
+        hash_  = x.hash_;
+        equal_ = x.equal_;
+        reserve(x.size());
+        for (const auto& e : x)
+            insert(e);
         return *this;
     }
 
-    point2d& operator=(std::pair<double, double>&& p) {
-        this->first  = std::move(p.first);
-        this->second = std::move(p.second);
+    // Takes over the table when the allocator comes along or both allocators are equal,
+    // moves the elements one by one into memory of its own allocator otherwise
+    flat_hash_map& operator=(flat_hash_map&& x)
+        noexcept(slot_traits::propagate_on_container_move_assignment::value || slot_traits::is_always_equal::value)
+    {
+        if (this == &x)
+            return *this;
+        if constexpr (slot_traits::propagate_on_container_move_assignment::value) {
+            destroy();
+            slot_alloc_  = std::move(x.slot_alloc_);
+            group_alloc_ = std::move(x.group_alloc_);
+        } else if (slot_alloc_ != x.slot_alloc_) {
+            clear();
+            hash_  = x.hash_;
+            equal_ = x.equal_;
+            move_elements(x);
+            return *this;
+        } else {
+            destroy();
+        }
+        hash_  = std::move(x.hash_);
+        equal_ = std::move(x.equal_);
+        take_table(x);
         return *this;
     }
 
-    // Returning reference to the member is deliberate since
-    // x() and y() are simply meant to be a convenience alias
-    // interface to avoid writing '.first' or '.second' 
-    constexpr double& x()       { return this->first;  }
-    constexpr double& y()       { return this->second; }
-    constexpr double  x() const { return this->first;  }
-    constexpr double  y() const { return this->second; }
+    ~flat_hash_map() { destroy(); }
 
-    friend point2d operator+(const point2d& a, const point2d& b) { return point2d(a.x() + b.x(), a.y() + b.y()); }
-    friend point2d operator-(const point2d& a, const point2d& b) { return point2d(a.x() - b.x(), a.y() - b.y()); }
-    friend point2d operator*(const point2d& a, const double   k) { return point2d(a.x() * k, a.y() * k); }
-    friend bool   operator==(const point2d& a, const point2d& b) { return a.x() == b.x() && a.y() == b.y(); }
-    friend bool   operator!=(const point2d& a, const point2d& b) { return !(a == b); }
-    friend point2d operator/(const point2d& a, double k) {
-        if (k != 0) {
-            return point2d(a.x() / k, a.y() / k);
-        } else {
-            throw std::invalid_argument("ATTEMPTED DIVISION BY ZERO FOR point2d");
+    // Swapping maps whose allocators neither propagate nor compare equal is undefined, as for the std containers
+    void swap(flat_hash_map& x) noexcept
+    {
+        using std::swap;
+        swap(hash_,        x.hash_);
+        swap(equal_,       x.equal_);
+        if constexpr (slot_traits::propagate_on_container_swap::value) {
+            swap(slot_alloc_,  x.slot_alloc_);
+            swap(group_alloc_, x.group_alloc_);
         }
+        swap(groups_,      x.groups_);
+        swap(slots_,       x.slots_);
+        swap(capacity_,    x.capacity_);
+        swap(size_,        x.size_);
+        swap(deleted_,     x.deleted_);
     }
-};
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::point3d
+    iterator       begin()       { iterator it(ctrl(), ctrl() + capacity_, slots_); it.skip_free(); return it; }
+    const_iterator begin() const { const_iterator it(ctrl(), ctrl() + capacity_, slots_); it.skip_free(); return it; }
+    iterator       end()         { return iterator(      ctrl() + capacity_, ctrl() + capacity_, slots_ + capacity_); }
+    const_iterator end()   const { return const_iterator(ctrl() + capacity_, ctrl() + capacity_, slots_ + capacity_); }
 
-class point3d : public point2d {
-public:
-    point3d(double xc = 0.0, double yc = 0.0, double zc = 0.0) : point2d(xc, yc), z_(zc) {}
+    size_t size()     const { return size_; }
+    size_t capacity() const { return capacity_; }
 
-    point3d(const point2d& p, double zc = 0.0) : point2d(p), z_(zc) {}
+    allocator_type get_allocator() const { return allocator_type(slot_alloc_); }
+    bool   empty()    const { return size_ == 0; }
+    bool   is_empty() const { return size_ == 0; }
 
-    template <class T, class U, class V, typename std::enable_if<
-                                                  std::is_arithmetic_v<T> &&
-                                                  std::is_arithmetic_v<U> &&
-                                                  std::is_arithmetic_v<V>, int>::type = 0>
-    point3d(const std::tuple<T, U, V>& p)
-        : point2d(std::get<0>(p), std::get<1>(p)),
-           z_(static_cast<double>(std::get<2>(p)))
-    {}
+    iterator find(const K& k)
+    {
+        const size_t i = find_index(k);
+        return i == npos ? end() : iterator_at(i);
+    }
 
-    point3d& operator=(const std::pair<double, double>& p) {
-        point2d::operator=(p);            // inherit behavior for x and y
-        z_ = 0;                           // reset to default
-        return *this;
+    const_iterator find(const K& k) const { return const_cast<flat_hash_map*>(this)->find(k); }
+
+    bool   contains(const K& k) const { return find_index(k) != npos; }
+    size_t count(   const K& k) const { return find_index(k) != npos; }
+
+    V& at(const K& k)
+    {
+        const size_t i = find_index(k);
+        if (i == npos)
+            throw std::out_of_range("KEY NOT FOUND IN flat_hash_map");
+        return slots_[i].second;
     }
 
-    point3d& operator=(std::pair<double, double>&& p) {
-        point2d::operator=(std::move(p)); // inherit behavior for x and y
-        z_ = 0;                           // reset to default
-        return *this;
+    const V& at(const K& k) const { return const_cast<flat_hash_map*>(this)->at(k); }
+
+    V& operator[](const K& k) { return try_emplace(k).first->second; }
+    V& operator[](K&& k)      { return try_emplace(std::move(k)).first->second; }
+
+    // Constructs the value from args only if k isn't in the map yet
+    template<class Key, class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& k, Args&&... args)
+    {
+        if (const size_t i = find_index(k); i != npos)
+            return {iterator_at(i), false};
+        const size_t h = hash(k);
+        const size_t i = prepare_insert(h);
+        slot_traits::construct(slot_alloc_, slots_ + i, std::piecewise_construct,
+            std::forward_as_tuple(std::forward<Key>(k)), std::forward_as_tuple(std::forward<Args>(args)...));
+        commit_insert(i, h);
+        return {iterator_at(i), true};
     }
 
-    // Returning reference to the member is deliberate since
-    // x(), y() and z() are simply meant to be a convenience alias
-    // interface to avoid writing '->first', '->second' or '->z_'
-    constexpr double& z()       { return z_; }
-    constexpr double  z() const { return z_; }
+    std::pair<iterator, bool> insert(const value_type& x) { return try_emplace(x.first, x.second); }
+    std::pair<iterator, bool> insert(value_type&& x)      { return try_emplace(x.first, std::move(x.second)); }
 
-    friend point3d operator+(const point3d& a, const point3d& b) { return point3d(a.x() + b.x(), a.y() + b.y(), a.z() + b.z()); }
-    friend point3d operator-(const point3d& a, const point3d& b) { return point3d(a.x() - b.x(), a.y() - b.y(), a.z() - b.z()); }
-    friend point3d operator*(const point3d& a, const double k)   { return point3d(a.x() * k, a.y() * k, a.z() * k); }
-    friend bool   operator==(const point3d& a, const point3d& b) { return a.x() == b.x() && a.y() == b.y() && a.z() == b.z(); }
-    friend bool   operator!=(const point3d& a, const point3d& b) { return !(a == b); }
+    template<class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type x(std::forward<Args>(args)...);
+        return try_emplace(x.first, std::move(x.second));
+    }
 
-    friend point3d operator/(const point3d& a, double k) {
-        if (k != 0) {
-            return point3d(a.x() / k, a.y() / k, a.z() / k);
-        }
-        else {
-            throw std::invalid_argument("ATTEMPTED DIVISION BY ZERO FOR point3d");
+    template<class M>
+    std::pair<iterator, bool> insert_or_assign(const K& k, M&& v)
+    {
+        auto r = try_emplace(k, std::forward<M>(v));
+        if (!r.second)
+            r.first->second = std::forward<M>(v);
+        return r;
+    }
+
+    size_t erase(const K& k)
+    {
+        const size_t i = find_index(k);
+        if (i == npos)
+            return 0;
+        erase_at(i);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        const size_t i = static_cast<size_t>(pos.ctrl_ - ctrl());
+        erase_at(i);
+        iterator it = iterator_at(i);
+        it.skip_free();
+        return it;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (ctrl()[i] >= 0)
+                slot_traits::destroy(slot_alloc_, slots_ + i);
+        if (capacity_ > 0)
+            std::memset(ctrl(), empty_slot, capacity_);
+        size_ = deleted_ = 0;
+    }
+
+    // Makes room for n elements without growing again
+    void reserve(size_t n)
+    {
+        size_t capacity = group_width;
+        while (capacity * 7 / 8 < n)
+            capacity *= 2;
+        if (capacity > capacity_)
+            rehash(capacity);
+    }
+
+    friend bool operator==(const flat_hash_map& a, const flat_hash_map& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (const auto& [k, v] : a) {
+            const auto it = b.find(k);
+            if (it == b.end() || !(it->second == v))
+                return false;
         }
+        return true;
     }
 
 private:
-    double z_;
-};
+    static constexpr size_t npos = size_t(-1);
 
-// ------------------------------------------------------------------------------------------ aliases
+    // std::hash of integers is the identity on common standard libraries,
+    // so the bits are mixed before the table takes the group and control bits
+    size_t hash(const K& k) const
+    {
+        uint64_t h = static_cast<uint64_t>(hash_(k)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
 
-using point = point2d;
+    static int8_t control_bits(size_t h) { return static_cast<int8_t>(h & 0x7F); }
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::queue
+    int8_t*       ctrl()       { return groups_ ? groups_->ctrl : nullptr; }
+    const int8_t* ctrl() const { return groups_ ? groups_->ctrl : nullptr; }
 
-template<class T, class C = std::deque<T>>
-class queue : public std::queue<T, C>, private zen::stackonly
-{
-public:
-    using std::queue<T, C>::queue; // inherit constructors, has to be explicit
+    iterator iterator_at(size_t i) { return iterator(ctrl() + i, ctrl() + capacity_, slots_ + i); }
 
-    queue(const std::queue<T, C>& q) : std::queue<T, C>(q) {}
-    
-    template<class Iterable>
-    queue(const Iterable& c)
+    // Groups are probed in triangular steps (+1, +2, +3, ...), which visits
+    // every group once when the number of groups is a power of two
+    template<class F>
+    size_t probe(size_t h, F f) const
     {
-        ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+        const size_t mask = capacity_ / group_width - 1;
+        size_t g = (h >> 7) & mask;
+        for (size_t step = 1; ; ++step) {
+            if (const size_t i = f(g); i != npos)
+                return i;
+            g = (g + step) & mask;
+        }
+    }
 
-        for (const auto& x : c)
-            my::push(x);
+    size_t find_index(const K& k) const
+    {
+        if (size_ == 0)
+            return npos;
+        const size_t h = hash(k);
+        const int8_t bits = control_bits(h);
+        size_t found = npos;
+        probe(h, [&](size_t g) -> size_t {
+            for (uint32_t m = groups_[g].match(bits); m != 0; m &= m - 1) {
+                const size_t i = g * group_width + static_cast<size_t>(std::countr_zero(m));
+                if (equal_(slots_[i].first, k))
+                    return found = i;
+            }
+            // A key is never placed beyond a group with an empty slot, so the search ends here
+            return groups_[g].match(empty_slot) != 0 ? size_t(0) : npos;
+        });
+        return found;
     }
 
-    bool is_empty() const { return my::empty(); }
+    // Finds a free slot for an element with hash h, growing the table if needed
+    size_t prepare_insert(size_t h)
+    {
+        if (size_ + deleted_ + 1 > capacity_ * 7 / 8)
+            rehash(size_ + 1 > capacity_ * 7 / 16 ? std::max(group_width, capacity_ * 2) : capacity_); // same size just drops the deleted ones
+        return probe(h, [&](size_t g) -> size_t {
+            const uint32_t m = groups_[g].match_free();
+            return m != 0 ? g * group_width + static_cast<size_t>(std::countr_zero(m)) : npos;
+        });
+    }
 
-private:
-    using my = queue<T, C>;
-};
+    // Marks slot i as full once its element is constructed
+    void commit_insert(size_t i, size_t h)
+    {
+        if (ctrl()[i] == deleted_slot)
+            --deleted_;
+        ctrl()[i] = control_bits(h);
+        ++size_;
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::priority_queue
+    void erase_at(size_t i)
+    {
+        slot_traits::destroy(slot_alloc_, slots_ + i);
+        --size_;
+        // A group that still has an empty slot stops every search that reaches it,
+        // so a slot freed in it can go back to empty instead of becoming deleted
+        const group& g = groups_[i / group_width];
+        if (g.match(empty_slot) != 0) {
+            ctrl()[i] = empty_slot;
+        } else {
+            ctrl()[i] = deleted_slot;
+            ++deleted_;
+        }
+    }
 
-template<
-    class T,
-    class C = std::vector<T>,
-    class L = std::less<typename C::value_type>
->
-class priority_queue : public std::priority_queue<T, C, L>, private zen::stackonly
+    void rehash(size_t capacity)
+    {
+        group*      old_groups   = groups_;
+        value_type* old_slots    = slots_;
+        const size_t old_capacity = capacity_;
+
+        groups_   = group_traits::allocate(group_alloc_, capacity / group_width);
+        slots_    = slot_traits::allocate(slot_alloc_, capacity);
+        capacity_ = capacity;
+        size_ = deleted_ = 0;
+        std::memset(ctrl(), empty_slot, capacity);
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_groups->ctrl[i] < 0)
+                continue;
+            const size_t h = hash(old_slots[i].first);
+            const size_t j = prepare_insert(h);
+            slot_traits::construct(slot_alloc_, slots_ + j, std::move(old_slots[i]));
+            commit_insert(j, h);
+            slot_traits::destroy(slot_alloc_, old_slots + i);
+        }
+        if (old_capacity > 0) {
+            group_traits::deallocate(group_alloc_, old_groups, old_capacity / group_width);
+            slot_traits::deallocate(slot_alloc_, old_slots, old_capacity);
+        }
+    }
+
+    // Takes over the table of x, leaving this one's (empty, after destroy()) to x
+    void take_table(flat_hash_map& x) noexcept
+    {
+        std::swap(groups_,   x.groups_);
+        std::swap(slots_,    x.slots_);
+        std::swap(capacity_, x.capacity_);
+        std::swap(size_,     x.size_);
+        std::swap(deleted_,  x.deleted_);
+    }
+
+    void move_elements(flat_hash_map& x)
+    {
+        reserve(x.size());
+        for (auto& e : x)
+            try_emplace(e.first, std::move(e.second));
+    }
+
+    void destroy()
+    {
+        if (capacity_ == 0)
+            return;
+        clear();
+        group_traits::deallocate(group_alloc_, groups_, capacity_ / group_width);
+        slot_traits::deallocate(slot_alloc_, slots_, capacity_);
+        groups_ = nullptr;
+        slots_  = nullptr;
+        capacity_ = 0;
+    }
+
+    [[no_unique_address]] H hash_;
+    [[no_unique_address]] E equal_;
+    [[no_unique_address]] slot_allocator  slot_alloc_;
+    [[no_unique_address]] group_allocator group_alloc_;
+
+    group*      groups_   = nullptr; // capacity_ / group_width groups of control bytes
+    value_type* slots_    = nullptr;
+    size_t      capacity_ = 0;       // a power of two, at least group_width, or 0
+    size_t      size_     = 0;
+    size_t      deleted_  = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::flat_map
+//
+// A sorted map on contiguous arrays, where zen::map allocates a tree node per element.
+// Keys and values are kept in two separate arrays, so a lookup's binary search only
+// touches keys, and iteration streams through memory. Insertion and erasure in the
+// middle shift the elements after it, so flat_map suits maps built once (or in bulk)
+// and then mostly read. Iterators yield pairs of references, like std::flat_map's.
+// Example: zen::flat_map<int, std::string> m = {{3, "c"}, {1, "a"}};
+//          for (auto [k, v] : m) ... // 1 a, 3 c
+
+template<class K, class V, class C = std::less<K>, class A = std::allocator<std::pair<const K, V>>>
+class flat_map : private zen::stackonly
 {
+    ZEN_STATIC_ASSERT((!std::is_same_v<V, bool>),
+        "flat_map<K, bool> IS NOT SUPPORTED (std::vector<bool> HAS NO REFERENCES TO ITS ELEMENTS), USE char OR flat_set<K>");
+
+    using key_container   = std::vector<K, typename std::allocator_traits<A>::template rebind_alloc<K>>;
+    using value_container = std::vector<V, typename std::allocator_traits<A>::template rebind_alloc<V>>;
+
+    template<bool Const>
+    class basic_iterator {
+        using value_pointer = std::conditional_t<Const, const V*, V*>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = std::pair<K, V>;
+        using reference         = std::pair<const K&, std::conditional_t<Const, const V&, V&>>;
+
+        // operator-> has to return something that outlives the call
+        struct pointer {
+            reference ref;
+            const reference* operator->() const { return &ref; }
+        };
+
+        basic_iterator() = default;
+
+        operator basic_iterator<true>() const { return basic_iterator<true>(key_, value_); }
+
+        reference operator*()                   const { return {*key_, *value_}; }
+        pointer   operator->()                  const { return {**this}; }
+        reference operator[](difference_type n) const { return {key_[n], value_[n]}; }
+
+        basic_iterator& operator++()    { ++key_; ++value_; return *this; }
+        basic_iterator& operator--()    { --key_; --value_; return *this; }
+        basic_iterator  operator++(int) { auto it = *this; ++*this; return it; }
+        basic_iterator  operator--(int) { auto it = *this; --*this; return it; }
+
+        basic_iterator& operator+=(difference_type n) { key_ += n; value_ += n; return *this; }
+        basic_iterator& operator-=(difference_type n) { key_ -= n; value_ -= n; return *this; }
+
+        friend basic_iterator  operator+(basic_iterator it, difference_type n) { return it += n; }
+        friend basic_iterator  operator+(difference_type n, basic_iterator it) { return it += n; }
+        friend basic_iterator  operator-(basic_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const basic_iterator& a, const basic_iterator& b) { return a.key_ - b.key_; }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a.key_ == b.key_; }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) { return a.key_ != b.key_; }
+        friend bool operator< (const basic_iterator& a, const basic_iterator& b) { return a.key_ <  b.key_; }
+        friend bool operator> (const basic_iterator& a, const basic_iterator& b) { return a.key_ >  b.key_; }
+        friend bool operator<=(const basic_iterator& a, const basic_iterator& b) { return a.key_ <= b.key_; }
+        friend bool operator>=(const basic_iterator& a, const basic_iterator& b) { return a.key_ >= b.key_; }
+
+    private:
+        friend class flat_map;
+        friend class basic_iterator<!Const>;
+
+        basic_iterator(const K* key, value_pointer value) : key_(key), value_(value) {}
+
+        const K*      key_   = nullptr;
+        value_pointer value_ = nullptr;
+    };
+
 public:
-    using std::priority_queue<T, C, L>::priority_queue; // inherit constructors, has to be explicit
+    using key_type       = K;
+    using mapped_type    = V;
+    using value_type     = std::pair<K, V>;
+    using size_type      = size_t;
+    using key_compare    = C;
+    using allocator_type = A;
+    using iterator       = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
 
-    priority_queue(const std::priority_queue<T, C, L>& q) : std::priority_queue<T, C, L>(q) {}
+    flat_map() = default;
+
+    explicit flat_map(const C& comp) : comp_(comp) {}
+
+    explicit flat_map(const A& alloc, const C& comp = C()) : keys_(alloc), values_(alloc), comp_(comp) {}
+
+    // The allocator-extended constructors, which nested pmr containers construct their elements with
+    flat_map(const flat_map& x, const A& alloc) : keys_(x.keys_, alloc), values_(x.values_, alloc), comp_(x.comp_) {}
+    flat_map(flat_map&& x,      const A& alloc) : keys_(std::move(x.keys_), alloc), values_(std::move(x.values_), alloc), comp_(x.comp_) {}
+
+    // Sorts once instead of inserting one by one, the first of equal keys wins like in std::map
+    template<class InputIt>
+    flat_map(InputIt first, InputIt last, const C& comp = C(), const A& alloc = A()) : keys_(alloc), values_(alloc), comp_(comp)
+    {
+        std::vector<value_type> elements(first, last);
+        std::stable_sort(elements.begin(), elements.end(),
+            [&](const value_type& a, const value_type& b) { return comp_(a.first, b.first); });
+        keys_.reserve(elements.size());
+        values_.reserve(elements.size());
+        for (auto& [k, v] : elements) {
+            if (!keys_.empty() && !comp_(keys_.back(), k))
+                continue; // equal to the previous key
+            keys_.push_back(std::move(k));
+            values_.push_back(std::move(v));
+        }
+    }
+
+    template<class InputIt>
+    flat_map(InputIt first, InputIt last, const A& alloc) : flat_map(first, last, C(), alloc) {}
+
+    flat_map(std::initializer_list<value_type> init, const C& comp = C(), const A& alloc = A()) : flat_map(init.begin(), init.end(), comp, alloc) {}
+    flat_map(std::initializer_list<value_type> init, const A& alloc) : flat_map(init.begin(), init.end(), C(), alloc) {}
+
+    allocator_type get_allocator() const { return allocator_type(keys_.get_allocator()); }
+
+    iterator       begin()       { return iterator(      keys_.data(), values_.data()); }
+    const_iterator begin() const { return const_iterator(keys_.data(), values_.data()); }
+    iterator       end()         { return begin() + static_cast<std::ptrdiff_t>(size()); }
+    const_iterator end()   const { return begin() + static_cast<std::ptrdiff_t>(size()); }
+
+    size_t size()     const { return keys_.size(); }
+    bool   empty()    const { return keys_.empty(); }
+    bool   is_empty() const { return keys_.empty(); }
+
+    void reserve(size_t n) { keys_.reserve(n); values_.reserve(n); }
+    void clear()           { keys_.clear();    values_.clear(); }
+
+    // The underlying arrays, sorted by key
+    const key_container&   keys()   const { return keys_; }
+    const value_container& values() const { return values_; }
+
+    iterator       lower_bound(const K& k)       { return begin() + index_of_lower_bound(k); }
+    const_iterator lower_bound(const K& k) const { return begin() + index_of_lower_bound(k); }
+
+    iterator find(const K& k)
+    {
+        const auto i = index_of_lower_bound(k);
+        return is_match(i, k) ? begin() + i : end();
+    }
+
+    const_iterator find(const K& k) const { return const_cast<flat_map*>(this)->find(k); }
+
+    bool   contains(const K& k) const { return is_match(index_of_lower_bound(k), k); }
+    size_t count(   const K& k) const { return contains(k); }
+
+    V& at(const K& k)
+    {
+        const auto i = index_of_lower_bound(k);
+        if (!is_match(i, k))
+            throw std::out_of_range("KEY NOT FOUND IN flat_map");
+        return values_[static_cast<size_t>(i)];
+    }
+
+    const V& at(const K& k) const { return const_cast<flat_map*>(this)->at(k); }
+
+    V& operator[](const K& k) { return (*try_emplace(k).first).second; }
+
+    template<class Key, class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& k, Args&&... args)
+    {
+        const auto i = index_of_lower_bound(k);
+        if (is_match(i, k))
+            return {begin() + i, false};
+        keys_.insert(keys_.begin() + i, std::forward<Key>(k));
+        try {
+            values_.insert(values_.begin() + i, V(std::forward<Args>(args)...));
+        } catch (...) {
+            keys_.erase(keys_.begin() + i); // keep the arrays in step
+            throw;
+        }
+        return {begin() + i, true};
+    }
+
+    std::pair<iterator, bool> insert(const value_type& x) { return try_emplace(x.first, x.second); }
+    std::pair<iterator, bool> insert(value_type&& x)      { return try_emplace(std::move(x.first), std::move(x.second)); }
+
+    template<class M>
+    std::pair<iterator, bool> insert_or_assign(const K& k, M&& v)
+    {
+        auto r = try_emplace(k, std::forward<M>(v));
+        if (!r.second)
+            (*r.first).second = std::forward<M>(v);
+        return r;
+    }
+
+    size_t erase(const K& k)
+    {
+        const auto i = index_of_lower_bound(k);
+        if (!is_match(i, k))
+            return 0;
+        erase(begin() + i);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        const auto i = pos - begin();
+        keys_.erase(keys_.begin() + i);
+        values_.erase(values_.begin() + i);
+        return begin() + i;
+    }
+
+    friend bool operator==(const flat_map& a, const flat_map& b) { return a.keys_ == b.keys_ && a.values_ == b.values_; }
+
+private:
+    std::ptrdiff_t index_of_lower_bound(const K& k) const
+    {
+        return std::lower_bound(keys_.begin(), keys_.end(), k, comp_) - keys_.begin();
+    }
+
+    bool is_match(std::ptrdiff_t i, const K& k) const
+    {
+        return static_cast<size_t>(i) < keys_.size() && !comp_(k, keys_[static_cast<size_t>(i)]);
+    }
+
+    key_container   keys_;
+    value_container values_;
+    [[no_unique_address]] C comp_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::flat_set
+//
+// A sorted set on a contiguous array, where zen::set allocates a tree node per
+// element. Like flat_map, it suits sets that are mostly read once built.
+// Example: zen::flat_set<int> s = {3, 1, 2, 3}; // 1 2 3
+//          s.contains(2); // true
+
+template<class K, class C = std::less<K>, class A = std::allocator<K>>
+class flat_set : private zen::stackonly
+{
+    using container = std::vector<K, A>;
+
+public:
+    using key_type       = K;
+    using value_type     = K;
+    using size_type      = size_t;
+    using key_compare    = C;
+    using allocator_type = A;
+    using iterator       = typename container::const_iterator; // elements are keys, so never mutable
+    using const_iterator = typename container::const_iterator;
+
+    flat_set() = default;
+
+    explicit flat_set(const C& comp) : comp_(comp) {}
+
+    explicit flat_set(const A& alloc, const C& comp = C()) : keys_(alloc), comp_(comp) {}
+
+    // The allocator-extended constructors, which nested pmr containers construct their elements with
+    flat_set(const flat_set& x, const A& alloc) : keys_(x.keys_, alloc), comp_(x.comp_) {}
+    flat_set(flat_set&& x,      const A& alloc) : keys_(std::move(x.keys_), alloc), comp_(x.comp_) {}
+
+    template<class InputIt>
+    flat_set(InputIt first, InputIt last, const C& comp = C(), const A& alloc = A()) : keys_(first, last, alloc), comp_(comp)
+    {
+        std::stable_sort(keys_.begin(), keys_.end(), comp_);
+        erase_duplicates();
+    }
+
+    template<class InputIt>
+    flat_set(InputIt first, InputIt last, const A& alloc) : flat_set(first, last, C(), alloc) {}
+
+    flat_set(std::initializer_list<K> init, const C& comp = C(), const A& alloc = A()) : flat_set(init.begin(), init.end(), comp, alloc) {}
+    flat_set(std::initializer_list<K> init, const A& alloc) : flat_set(init.begin(), init.end(), C(), alloc) {}
+
+    allocator_type get_allocator() const { return keys_.get_allocator(); }
+
+    iterator begin() const { return keys_.begin(); }
+    iterator end()   const { return keys_.end(); }
+
+    size_t size()     const { return keys_.size(); }
+    bool   empty()    const { return keys_.empty(); }
+    bool   is_empty() const { return keys_.empty(); }
+
+    void reserve(size_t n) { keys_.reserve(n); }
+    void clear()           { keys_.clear(); }
+
+    // The underlying sorted array
+    const container& keys() const { return keys_; }
+
+    iterator lower_bound(const K& k) const { return std::lower_bound(keys_.begin(), keys_.end(), k, comp_); }
+    iterator upper_bound(const K& k) const { return std::upper_bound(keys_.begin(), keys_.end(), k, comp_); }
+
+    iterator find(const K& k) const
+    {
+        const auto it = lower_bound(k);
+        return it != end() && !comp_(k, *it) ? it : end();
+    }
+
+    bool   contains(const K& k) const { return find(k) != end(); }
+    size_t count(   const K& k) const { return contains(k); }
+
+    std::pair<iterator, bool> insert(const K& k) { return emplace(k); }
+    std::pair<iterator, bool> insert(K&& k)      { return emplace(std::move(k)); }
+
+    // Appends the range, sorts just the new part and merges it in
+    template<class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        const auto middle = static_cast<std::ptrdiff_t>(keys_.size());
+        keys_.insert(keys_.end(), first, last);
+        std::stable_sort(keys_.begin() + middle, keys_.end(), comp_);
+        std::inplace_merge(keys_.begin(), keys_.begin() + middle, keys_.end(), comp_);
+        erase_duplicates();
+    }
+
+    void insert(std::initializer_list<K> init) { insert(init.begin(), init.end()); }
+
+    template<class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        K k(std::forward<Args>(args)...);
+        const auto it = lower_bound(k);
+        if (it != end() && !comp_(k, *it))
+            return {it, false};
+        return {keys_.insert(it, std::move(k)), true};
+    }
+
+    size_t erase(const K& k)
+    {
+        const auto it = find(k);
+        if (it == end())
+            return 0;
+        keys_.erase(it);
+        return 1;
+    }
+
+    iterator erase(iterator pos) { return keys_.erase(pos); }
+
+    friend bool operator==(const flat_set& a, const flat_set& b) { return a.keys_ == b.keys_; }
+
+private:
+    // On sorted keys, keeps the first of every run of equal ones
+    void erase_duplicates()
+    {
+        keys_.erase(std::unique(keys_.begin(), keys_.end(),
+            [&](const K& a, const K& b) { return !comp_(a, b) && !comp_(b, a); }), keys_.end());
+    }
+
+    container keys_;
+    [[no_unique_address]] C comp_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::forward_list
+
+template<class T, class A = std::allocator<T>>
+class forward_list : public std::forward_list<T, A>, private zen::stackonly
+{
+public:
+    using std::forward_list<T, A>::forward_list; // inherit constructors, has to be explicit
+
+    forward_list(const std::forward_list<T, A>& x) : std::forward_list<T, A>(x) {}
+
+    template<class Pred>
+    typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
+        contains(Pred p) const
+    {
+        return std::find_if(my::begin(), my::end(), p) != my::end();
+    }
+    bool contains(const T& x) const { return std::find(my::begin(), my::end(), x) != my::end(); }
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = forward_list<T, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::in
+
+// Declarative range-for loop. Note that apart from an intuitive
+// reading, "in" can also be thought of standing for "interval".
+// Example: for (int i : zen::in(5))         // from  0 to  5
+// Example: for (int i : zen::in(1, 10))     // from  1 to 10
+// Example: for (int i : zen::in(10, 1, -1)) // from 10 to  1, step -1
+class in {
+public:
+    in(int end)
+        : begin_(0), end_(end), step_(1) {}
+
+    in(int begin, int end, int step = 1)
+        : begin_(begin), end_(end), step_(step) {}
+
+    class iterator {
+    public:
+        iterator(int n = 0, int step = 1) : n_(n), step_(step) {}
+        iterator& operator++() { n_ += step_; return *this; }
+        const int& operator*()             const { return n_; }
+        bool operator!=(const iterator& x) const {
+            return (step_ > 0) ? (n_ < x.n_) : (n_ > x.n_);
+        }
+    private:
+        int n_;
+        int step_;
+    };
+
+    iterator begin() const { return iterator(begin_, step_); }
+    iterator end()   const { return iterator(end_,   step_); }
+
+private:
+    int begin_;
+    int end_;
+    int step_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::list
+
+template<class T, class A = std::allocator<T>>
+class list : public std::list<T, A>, private zen::stackonly
+{
+public:
+    using std::list<T, A>::list; // inherit constructors, has to be explicit
+
+    list(const std::list<T, A>& x) : std::list<T, A>(x) {}
+
+    template<class Pred>
+    typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
+        contains(Pred p) const
+    {
+        return std::find_if(my::begin(), my::end(), p) != my::end();
+    }
+    bool contains(const T& x) const { return std::find(my::begin(), my::end(), x) != my::end(); }
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = list<T, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::map
+
+template<class K, class V, class C = std::less<K>, class A = std::allocator<std::pair<const K, V>>>
+class map : public std::map<K, V, C, A>, private zen::stackonly
+{
+public:
+    using std::map<K, V, C, A>::map; // inherit constructors, has to be explicit
+
+    map(const std::map<K, V, C, A>& m) : std::map<K, V, C, A>(m) {}
+
+    template<class Kx, class Vx, class Cx, class Ax>
+    map(const std::map<Kx, Vx, Cx, Ax>& m) : std::map<K, V, C, A>(m.begin(), m.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = map<K, V, C, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::multimap
+
+template<class K, class V, class C = std::less<K>, class A = std::allocator<std::pair<const K, V>>>
+class multimap : public std::multimap<K, V, C, A>, private zen::stackonly
+{
+public:
+    using std::multimap<K, V, C, A>::multimap; // inherit constructors, has to be explicit
+
+    multimap(const std::multimap<K, V, C, A>& m) : std::multimap<K, V, C, A>(m) {}
+
+    template<class Kx, class Vx, class Cx, class Ax>
+    multimap(const std::multimap<Kx, Vx, Cx, Ax>& m) : std::multimap<K, V, C, A>(m.begin(), m.end()) {}
+
+    // std::map::operator[] is not defined, but
+    // zen::map::operator[] returns an std::vector
+    // composed of values corresponding to the parameter key.
+    std::vector<V> operator[](const K& key) {
+        auto range = my::equal_range(key);
+        std::vector<V> values;
+        for (auto it = range.first; it != range.second; ++it) {
+            values.push_back(it->second);
+        }
+        return values;
+    }
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = multimap<K, V, C, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::point2d
+
+class point2d : public std::pair<double, double> {
+public:
+    point2d(double xc = 0.0, double yc = 0.0)    : std::pair<double, double>(xc, yc)       {}
+    point2d(const std::pair<double, double>&  p) : std::pair<double, double>(p)            {}
+    point2d(      std::pair<double, double>&& p) : std::pair<double, double>(std::move(p)) {}
+
+    // Allows conversions from other arithmetic pair types
+    template <class T, class U, typename std::enable_if<
+                                         std::is_arithmetic_v<T> &&
+                                         std::is_arithmetic_v<U>, int>::type = 0>
+    point2d(const std::pair<T, U>& p)
+        : std::pair<double, double>(
+            static_cast<double>(p.first),
+            static_cast<double>(p.second)
+        )
+    {}
+
+    point2d& operator=(const std::pair<double, double>& p) {
+        this->first  = p.first;
+        this->second = p.second;
+        return *this;
+    }
+
+    point2d& operator=(std::pair<double, double>&& p) {
+        this->first  = std::move(p.first);
+        this->second = std::move(p.second);
+        return *this;
+    }
+
+    // Returning reference to the member is deliberate since
+    // x() and y() are simply meant to be a convenience alias
+    // interface to avoid writing '.first' or '.second' 
+    constexpr double& x()       { return this->first;  }
+    constexpr double& y()       { return this->second; }
+    constexpr double  x() const { return this->first;  }
+    constexpr double  y() const { return this->second; }
+
+    friend point2d operator+(const point2d& a, const point2d& b) { return point2d(a.x() + b.x(), a.y() + b.y()); }
+    friend point2d operator-(const point2d& a, const point2d& b) { return point2d(a.x() - b.x(), a.y() - b.y()); }
+    friend point2d operator*(const point2d& a, const double   k) { return point2d(a.x() * k, a.y() * k); }
+    friend bool   operator==(const point2d& a, const point2d& b) { return a.x() == b.x() && a.y() == b.y(); }
+    friend bool   operator!=(const point2d& a, const point2d& b) { return !(a == b); }
+    friend point2d operator/(const point2d& a, double k) {
+        if (k != 0) {
+            return point2d(a.x() / k, a.y() / k);
+        } else {
+            throw std::invalid_argument("ATTEMPTED DIVISION BY ZERO FOR point2d");
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::point3d
+
+class point3d : public point2d {
+public:
+    point3d(double xc = 0.0, double yc = 0.0, double zc = 0.0) : point2d(xc, yc), z_(zc) {}
+
+    point3d(const point2d& p, double zc = 0.0) : point2d(p), z_(zc) {}
+
+    template <class T, class U, class V, typename std::enable_if<
+                                                  std::is_arithmetic_v<T> &&
+                                                  std::is_arithmetic_v<U> &&
+                                                  std::is_arithmetic_v<V>, int>::type = 0>
+    point3d(const std::tuple<T, U, V>& p)
+        : point2d(std::get<0>(p), std::get<1>(p)),
+           z_(static_cast<double>(std::get<2>(p)))
+    {}
+
+    point3d& operator=(const std::pair<double, double>& p) {
+        point2d::operator=(p);            // inherit behavior for x and y
+        z_ = 0;                           // reset to default
+        return *this;
+    }
+
+    point3d& operator=(std::pair<double, double>&& p) {
+        point2d::operator=(std::move(p)); // inherit behavior for x and y
+        z_ = 0;                           // reset to default
+        return *this;
+    }
+
+    // Returning reference to the member is deliberate since
+    // x(), y() and z() are simply meant to be a convenience alias
+    // interface to avoid writing '->first', '->second' or '->z_'
+    constexpr double& z()       { return z_; }
+    constexpr double  z() const { return z_; }
+
+    friend point3d operator+(const point3d& a, const point3d& b) { return point3d(a.x() + b.x(), a.y() + b.y(), a.z() + b.z()); }
+    friend point3d operator-(const point3d& a, const point3d& b) { return point3d(a.x() - b.x(), a.y() - b.y(), a.z() - b.z()); }
+    friend point3d operator*(const point3d& a, const double k)   { return point3d(a.x() * k, a.y() * k, a.z() * k); }
+    friend bool   operator==(const point3d& a, const point3d& b) { return a.x() == b.x() && a.y() == b.y() && a.z() == b.z(); }
+    friend bool   operator!=(const point3d& a, const point3d& b) { return !(a == b); }
+
+    friend point3d operator/(const point3d& a, double k) {
+        if (k != 0) {
+            return point3d(a.x() / k, a.y() / k, a.z() / k);
+        }
+        else {
+            throw std::invalid_argument("ATTEMPTED DIVISION BY ZERO FOR point3d");
+        }
+    }
+
+private:
+    double z_;
+};
+
+// ------------------------------------------------------------------------------------------ aliases
+
+using point = point2d;
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::point_array
+//
+// Points stored as a structure of arrays: all the x coordinates contiguously, then all
+// the y (and z) coordinates, every plane aligned to a cache line. Batch operations
+// then stream through whole planes with AVX2 (when the CPU has it), four points per
+// instruction, instead of constructing one zen::point2d per operation.
+// Example: zen::point2d_array a(points);      // from any range of zen::point2d
+//          a.scale(2.0);
+//          a.add(zen::point2d(1.0, -1.0));
+//          auto [lo, hi] = a.bounding_box();
+//          auto d = a.distances(a.centroid());
+
+namespace internal::simd {
+
+#if ZEN_SIMD_X86
+
+// The planes of a point array are 64-byte aligned, hence the aligned loads below
+
+ZEN_TARGET("avx2")
+inline void add_avx2(double* a, const double* b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm256_store_pd(a + i, _mm256_add_pd(_mm256_load_pd(a + i), _mm256_load_pd(b + i)));
+    for (; i < n; ++i) a[i] += b[i];
+}
+
+ZEN_TARGET("avx2")
+inline void add_avx2(double* a, double c, size_t n)
+{
+    const __m256d vc = _mm256_set1_pd(c);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm256_store_pd(a + i, _mm256_add_pd(_mm256_load_pd(a + i), vc));
+    for (; i < n; ++i) a[i] += c;
+}
+
+ZEN_TARGET("avx2")
+inline void scale_avx2(double* a, double k, size_t n)
+{
+    const __m256d vk = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm256_store_pd(a + i, _mm256_mul_pd(_mm256_load_pd(a + i), vk));
+    for (; i < n; ++i) a[i] *= k;
+}
+
+ZEN_TARGET("avx2")
+inline void min_max_avx2(const double* a, size_t n, double& lo, double& hi)
+{
+    size_t i = 0;
+    if (n >= 4) {
+        __m256d vlo = _mm256_load_pd(a), vhi = vlo;
+        for (i = 4; i + 4 <= n; i += 4) {
+            const __m256d v = _mm256_load_pd(a + i);
+            vlo = _mm256_min_pd(vlo, v);
+            vhi = _mm256_max_pd(vhi, v);
+        }
+        alignas(32) double l[4], h[4];
+        _mm256_store_pd(l, vlo);
+        _mm256_store_pd(h, vhi);
+        lo = std::min({ lo, l[0], l[1], l[2], l[3] });
+        hi = std::max({ hi, h[0], h[1], h[2], h[3] });
+    }
+    for (; i < n; ++i) {
+        lo = std::min(lo, a[i]);
+        hi = std::max(hi, a[i]);
+    }
+}
+
+// out[i] = |point i - p|
+template<size_t Dim>
+ZEN_TARGET("avx2")
+inline void distances_avx2(const double* const* planes, const double* p, double* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_setzero_pd();
+        for (size_t d = 0; d < Dim; ++d) {
+            const __m256d v = _mm256_sub_pd(_mm256_load_pd(planes[d] + i), _mm256_set1_pd(p[d]));
+            s = _mm256_add_pd(s, _mm256_mul_pd(v, v));
+        }
+        _mm256_storeu_pd(out + i, _mm256_sqrt_pd(s));
+    }
+    for (; i < n; ++i) {
+        double s = 0;
+        for (size_t d = 0; d < Dim; ++d) s += (planes[d][i] - p[d]) * (planes[d][i] - p[d]);
+        out[i] = std::sqrt(s);
+    }
+}
+
+// out[i] = point i . p
+template<size_t Dim>
+ZEN_TARGET("avx2")
+inline void dots_avx2(const double* const* planes, const double* p, double* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_setzero_pd();
+        for (size_t d = 0; d < Dim; ++d)
+            s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_load_pd(planes[d] + i), _mm256_set1_pd(p[d])));
+        _mm256_storeu_pd(out + i, s);
+    }
+    for (; i < n; ++i) {
+        double s = 0;
+        for (size_t d = 0; d < Dim; ++d) s += planes[d][i] * p[d];
+        out[i] = s;
+    }
+}
+
+#endif // ZEN_SIMD_X86
+
+inline void add(double* a, const double* b, size_t n)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return add_avx2(a, b, n);
+#endif
+    for (size_t i = 0; i < n; ++i) a[i] += b[i];
+}
+
+inline void add(double* a, double c, size_t n)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return add_avx2(a, c, n);
+#endif
+    for (size_t i = 0; i < n; ++i) a[i] += c;
+}
+
+inline void scale(double* a, double k, size_t n)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return scale_avx2(a, k, n);
+#endif
+    for (size_t i = 0; i < n; ++i) a[i] *= k;
+}
+
+inline void min_max(const double* a, size_t n, double& lo, double& hi)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return min_max_avx2(a, n, lo, hi);
+#endif
+    for (size_t i = 0; i < n; ++i) {
+        lo = std::min(lo, a[i]);
+        hi = std::max(hi, a[i]);
+    }
+}
+
+template<size_t Dim>
+void distances(const double* const* planes, const double* p, double* out, size_t n)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return distances_avx2<Dim>(planes, p, out, n);
+#endif
+    for (size_t i = 0; i < n; ++i) {
+        double s = 0;
+        for (size_t d = 0; d < Dim; ++d) s += (planes[d][i] - p[d]) * (planes[d][i] - p[d]);
+        out[i] = std::sqrt(s);
+    }
+}
+
+template<size_t Dim>
+void dots(const double* const* planes, const double* p, double* out, size_t n)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2) return dots_avx2<Dim>(planes, p, out, n);
+#endif
+    for (size_t i = 0; i < n; ++i) {
+        double s = 0;
+        for (size_t d = 0; d < Dim; ++d) s += planes[d][i] * p[d];
+        out[i] = s;
+    }
+}
+
+} // namespace internal::simd
+
+template<size_t Dim>
+class basic_point_array {
+    static_assert(Dim == 2 || Dim == 3, "POINT ARRAYS ARE EITHER 2D OR 3D");
+public:
+    using point_type = std::conditional_t<Dim == 2, point2d, point3d>;
+    using size_type  = size_t;
+
+    static constexpr size_t dimensions = Dim;
+    static constexpr size_t alignment  = 64; // every plane starts on a cache line
+
+    basic_point_array() = default;
+
+    explicit basic_point_array(size_t n) { resize(n); }
+
+    // From any range of points, like a zen::points2d or a std::vector<zen::point3d>
+    template<class Iterable, typename std::enable_if<
+        std::is_convertible_v<decltype(*std::begin(std::declval<const Iterable&>())), point_type>, int>::type = 0>
+    explicit basic_point_array(const Iterable& points)
+    {
+        if constexpr (requires { std::size(points); })
+            reserve(std::size(points));
+        for (const auto& p : points)
+            push_back(p);
+    }
+
+    basic_point_array(std::initializer_list<point_type> points) : basic_point_array(std::vector<point_type>(points)) {}
+
+    basic_point_array(const basic_point_array& other) { *this = other; }
+    basic_point_array(basic_point_array&& other) noexcept { swap(other); }
+
+    basic_point_array& operator=(const basic_point_array& other)
+    {
+        if (this != &other) {
+            clear();
+            reserve(other.size_);
+            for (size_t d = 0; d < Dim; ++d)
+                std::copy_n(other.plane(d), other.size_, plane(d));
+            size_ = other.size_;
+        }
+        return *this;
+    }
+
+    basic_point_array& operator=(basic_point_array&& other) noexcept
+    {
+        basic_point_array(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(basic_point_array& other) noexcept
+    {
+        std::swap(data_,     other.data_);
+        std::swap(size_,     other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    size_t size()     const { return size_;      }
+    size_t capacity() const { return capacity_;  }
+    bool   is_empty() const { return size_ == 0; }
+
+    void clear() { size_ = 0; }
+
+    void reserve(size_t n)
+    {
+        if (n <= capacity_) return;
+        const size_t capacity = (std::max(n, 2 * capacity_) + 7) & ~size_t(7); // whole cache lines per plane
+        storage data(static_cast<double*>(::operator new(Dim * capacity * sizeof(double), std::align_val_t(alignment))));
+        for (size_t d = 0; d < Dim; ++d)
+            std::copy_n(plane(d), size_, data.get() + d * capacity);
+        data_     = std::move(data);
+        capacity_ = capacity;
+    }
+
+    // New points are at the origin
+    void resize(size_t n)
+    {
+        reserve(n);
+        for (size_t d = 0; d < Dim && n > size_; ++d)
+            std::fill(plane(d) + size_, plane(d) + n, 0.0);
+        size_ = n;
+    }
+
+    void push_back(const point_type& p)
+    {
+        if (size_ == capacity_)
+            reserve(size_ + 1);
+        for (size_t d = 0; d < Dim; ++d)
+            plane(d)[size_] = coordinate(p, d);
+        ++size_;
+    }
+
+    point_type operator[](size_t i) const
+    {
+        if constexpr (Dim == 2) return point_type(plane(0)[i], plane(1)[i]);
+        else                    return point_type(plane(0)[i], plane(1)[i], plane(2)[i]);
+    }
+
+    point_type at(size_t i) const
+    {
+        if (i >= size_)
+            throw std::out_of_range("POINT ARRAY INDEX OUT OF RANGE");
+        return (*this)[i];
+    }
+
+    void set(size_t i, const point_type& p)
+    {
+        for (size_t d = 0; d < Dim; ++d)
+            plane(d)[i] = coordinate(p, d);
+    }
+
+    double& x(size_t i)       { return plane(0)[i]; }
+    double& y(size_t i)       { return plane(1)[i]; }
+    double  x(size_t i) const { return plane(0)[i]; }
+    double  y(size_t i) const { return plane(1)[i]; }
+
+    template<size_t D = Dim, typename std::enable_if<D == 3, int>::type = 0>
+    double& z(size_t i)       { return plane(2)[i]; }
+    template<size_t D = Dim, typename std::enable_if<D == 3, int>::type = 0>
+    double  z(size_t i) const { return plane(2)[i]; }
+
+    // The coordinates of all points along dimension d (0 for x, 1 for y, 2 for z)
+    std::span<double>       coordinates(size_t d)       { return { plane(d), size_ }; }
+    std::span<const double> coordinates(size_t d) const { return { plane(d), size_ }; }
+
+    std::vector<point_type> points() const
+    {
+        std::vector<point_type> v;
+        v.reserve(size_);
+        for (size_t i = 0; i < size_; ++i)
+            v.push_back((*this)[i]);
+        return v;
+    }
+
+    // Translates every point by p
+    basic_point_array& add(const point_type& p)
+    {
+        for (size_t d = 0; d < Dim; ++d)
+            internal::simd::add(plane(d), coordinate(p, d), size_);
+        return *this;
+    }
+
+    // Adds the points of 'other' pointwise
+    basic_point_array& add(const basic_point_array& other)
+    {
+        if (other.size_ != size_)
+            throw std::invalid_argument("POINT ARRAYS OF DIFFERENT SIZES");
+        for (size_t d = 0; d < Dim; ++d)
+            internal::simd::add(plane(d), other.plane(d), size_);
+        return *this;
+    }
+
+    basic_point_array& scale(double k)
+    {
+        for (size_t d = 0; d < Dim; ++d)
+            internal::simd::scale(plane(d), k, size_);
+        return *this;
+    }
+
+    // The distance of every point to p, into 'out' (of at least size() elements) or a new vector
+    void distances(const point_type& p, std::span<double> out) const
+    {
+        if (out.size() < size_)
+            throw std::invalid_argument("OUTPUT SPAN SMALLER THAN THE POINT ARRAY");
+        const auto [planes, c] = planes_and(p);
+        internal::simd::distances<Dim>(planes.data(), c.data(), out.data(), size_);
+    }
+
+    std::vector<double> distances(const point_type& p) const
+    {
+        std::vector<double> out(size_);
+        distances(p, out);
+        return out;
+    }
+
+    // The dot product of every point (as a vector) with p, into 'out' or a new vector
+    void dots(const point_type& p, std::span<double> out) const
+    {
+        if (out.size() < size_)
+            throw std::invalid_argument("OUTPUT SPAN SMALLER THAN THE POINT ARRAY");
+        const auto [planes, c] = planes_and(p);
+        internal::simd::dots<Dim>(planes.data(), c.data(), out.data(), size_);
+    }
+
+    std::vector<double> dots(const point_type& p) const
+    {
+        std::vector<double> out(size_);
+        dots(p, out);
+        return out;
+    }
+
+    // The corners of the smallest axis-aligned box holding all points
+    std::pair<point_type, point_type> bounding_box() const
+    {
+        if (size_ == 0)
+            throw std::logic_error("BOUNDING BOX OF AN EMPTY POINT ARRAY");
+        point_type lo, hi;
+        for (size_t d = 0; d < Dim; ++d) {
+            double l = plane(d)[0], h = plane(d)[0];
+            internal::simd::min_max(plane(d), size_, l, h);
+            coordinate(lo, d) = l;
+            coordinate(hi, d) = h;
+        }
+        return { lo, hi };
+    }
+
+    point_type centroid() const
+    {
+        if (size_ == 0)
+            throw std::logic_error("CENTROID OF AN EMPTY POINT ARRAY");
+        point_type c;
+        for (size_t d = 0; d < Dim; ++d)
+            coordinate(c, d) = internal::simd::sum(plane(d), size_) / static_cast<double>(size_);
+        return c;
+    }
+
+private:
+    struct aligned_delete {
+        void operator()(double* p) const { ::operator delete(p, std::align_val_t(alignment)); }
+    };
+    using storage = std::unique_ptr<double[], aligned_delete>;
+
+    double*       plane(size_t d)       { return data_.get() + d * capacity_; }
+    const double* plane(size_t d) const { return data_.get() + d * capacity_; }
+
+    static double& coordinate(point_type& p, size_t d)       { return d == 0 ? p.x() : d == 1 ? p.y() : z_of(p); }
+    static double  coordinate(const point_type& p, size_t d) { return d == 0 ? p.x() : d == 1 ? p.y() : z_of(p); }
+
+    static double& z_of(point_type& p)       { if constexpr (Dim == 3) return p.z(); else return p.y(); }
+    static double  z_of(const point_type& p) { if constexpr (Dim == 3) return p.z(); else return p.y(); }
+
+    std::pair<std::array<const double*, Dim>, std::array<double, Dim>> planes_and(const point_type& p) const
+    {
+        std::pair<std::array<const double*, Dim>, std::array<double, Dim>> r;
+        for (size_t d = 0; d < Dim; ++d) {
+            r.first[d]  = plane(d);
+            r.second[d] = coordinate(p, d);
+        }
+        return r;
+    }
+
+    storage data_;
+    size_t  size_     = 0;
+    size_t  capacity_ = 0;
+};
+
+using point2d_array = basic_point_array<2>;
+using point3d_array = basic_point_array<3>;
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::kd_tree
+//
+// A k-d tree over 2D or 3D points for nearest-neighbour and radius queries. The tree
+// is implicit: the points are reordered so that every node is the median of its
+// range, split along the axis on which the range is widest, with the nodes below
+// it to its left and right in the same array. There are no node objects and no
+// pointers, just one contiguous array of points, and ranges of up to leaf_size
+// points are scanned linearly. Large trees are built on several threads, and the
+// batched queries spread their queries over threads too. Queries return indices
+// into the points the tree was built from.
+// Example: zen::kd_tree2d tree(zen::execution::par, points);
+//          auto five  = tree.nearest(zen::point2d(0.5, 0.5), 5);   // closest first
+//          auto close = tree.within(zen::point2d(0.5, 0.5), 0.1);  // any order
+//          auto all   = tree.nearest(zen::execution::par, queries, 5);
+
+// The results of a batch of radius queries, stored back to back
+struct neighbours {
+    std::vector<size_t> offsets{0}; // the results of query i are indices[offsets[i], offsets[i + 1])
+    std::vector<size_t> indices;
+
+    size_t size() const { return offsets.size() - 1; }
+
+    std::span<const size_t> operator[](size_t i) const { return { indices.data() + offsets[i], offsets[i + 1] - offsets[i] }; }
+};
+
+template<size_t Dim>
+class basic_kd_tree {
+    static_assert(Dim == 2 || Dim == 3, "K-D TREES ARE EITHER 2D OR 3D");
+public:
+    using point_type = std::conditional_t<Dim == 2, point2d, point3d>;
+
+    static constexpr size_t leaf_size = 16;
+
+    basic_kd_tree() = default;
+
+    // From any range of points, or a zen::basic_point_array
+    template<class Points>
+    explicit basic_kd_tree(const Points& points) : basic_kd_tree(execution::seq, points) {}
+
+    template<class ExecutionPolicy, class Points>
+        requires execution::is_execution_policy_v<ExecutionPolicy>
+    basic_kd_tree(ExecutionPolicy&& policy, const Points& points)
+    {
+        if constexpr (std::is_same_v<Points, basic_point_array<Dim>>) {
+            nodes_.reserve(points.size());
+            for (size_t i = 0; i < points.size(); ++i)
+                nodes_.push_back({ coordinates(points[i]), i });
+        } else {
+            if constexpr (requires { std::size(points); })
+                nodes_.reserve(std::size(points));
+            for (const point_type& p : points)
+                nodes_.push_back({ coordinates(p), nodes_.size() });
+        }
+        axes_.resize(nodes_.size());
+
+        unsigned threads = 1;
+        if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+            threads = internal::as_parallel(policy).threads;
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        build(0, nodes_.size(), threads);
+    }
+
+    size_t size()     const { return nodes_.size();  }
+    bool   is_empty() const { return nodes_.empty(); }
+
+    // The indices of the k points closest to q, closest first (ties by index)
+    std::vector<size_t> nearest(const point_type& q, size_t k) const
+    {
+        std::vector<std::pair<double, size_t>> heap;
+        std::vector<size_t> result;
+        nearest(coordinates(q), k, heap, result);
+        return result;
+    }
+
+    // The indices of the points at most 'radius' away from q, in no particular order
+    std::vector<size_t> within(const point_type& q, double radius) const
+    {
+        std::vector<size_t> result;
+        if (!is_empty())
+            search_within(0, nodes_.size(), coordinates(q), radius * radius, result);
+        return result;
+    }
+
+    // The k nearest points of every query: row i of the returned matrix, min(k, size())
+    // indices long, holds those of queries[i], closest first
+    template<class ExecutionPolicy>
+        requires execution::is_execution_policy_v<ExecutionPolicy>
+    std::vector<size_t> nearest(ExecutionPolicy&& policy, std::span<const point_type> queries, size_t k) const
+    {
+        const size_t row = std::min(k, size());
+        std::vector<size_t> result(queries.size() * row);
+        for_blocks(policy, queries.size(), [&](size_t begin, size_t end) {
+            std::vector<std::pair<double, size_t>> heap; // reused for all queries of the block
+            std::vector<size_t> found;
+            for (size_t i = begin; i < end; ++i) {
+                nearest(coordinates(queries[i]), k, heap, found);
+                std::copy(found.begin(), found.end(), result.begin() + i * row);
+            }
+        });
+        return result;
+    }
+
+    std::vector<size_t> nearest(std::span<const point_type> queries, size_t k) const { return nearest(execution::seq, queries, k); }
+
+    // The points within 'radius' of every query
+    template<class ExecutionPolicy>
+        requires execution::is_execution_policy_v<ExecutionPolicy>
+    neighbours within(ExecutionPolicy&& policy, std::span<const point_type> queries, double radius) const
+    {
+        // Every block collects its results on its own, then they're concatenated in order
+        std::vector<neighbours> parts((queries.size() + query_block - 1) / query_block);
+        for_blocks(policy, queries.size(), [&](size_t begin, size_t end) {
+            neighbours& part = parts[begin / query_block];
+            for (size_t i = begin; i < end; ++i) {
+                if (!is_empty())
+                    search_within(0, nodes_.size(), coordinates(queries[i]), radius * radius, part.indices);
+                part.offsets.push_back(part.indices.size());
+            }
+        });
+
+        neighbours result;
+        for (const neighbours& part : parts) {
+            const size_t base = result.indices.size();
+            result.indices.insert(result.indices.end(), part.indices.begin(), part.indices.end());
+            for (size_t i = 1; i < part.offsets.size(); ++i)
+                result.offsets.push_back(base + part.offsets[i]);
+        }
+        return result;
+    }
+
+    neighbours within(std::span<const point_type> queries, double radius) const { return within(execution::seq, queries, radius); }
+
+private:
+    using coords = std::array<double, Dim>;
+
+    struct node {
+        coords p;
+        size_t index; // in the points the tree was built from
+    };
+
+    static coords coordinates(const point_type& p)
+    {
+        if constexpr (Dim == 2) return { p.x(), p.y() };
+        else                    return { p.x(), p.y(), p.z() };
+    }
+
+    static double distance2(const coords& a, const coords& b)
+    {
+        double s = 0;
+        for (size_t d = 0; d < Dim; ++d) s += (a[d] - b[d]) * (a[d] - b[d]);
+        return s;
+    }
+
+    // Splits [lo, hi) at its median along its widest axis, then builds both halves,
+    // the left one on a thread of its own while there are threads to spare
+    void build(size_t lo, size_t hi, unsigned threads)
+    {
+        if (hi - lo <= leaf_size)
+            return;
+
+        coords min = nodes_[lo].p, max = nodes_[lo].p;
+        for (size_t i = lo + 1; i < hi; ++i)
+            for (size_t d = 0; d < Dim; ++d) {
+                min[d] = std::min(min[d], nodes_[i].p[d]);
+                max[d] = std::max(max[d], nodes_[i].p[d]);
+            }
+        uint8_t axis = 0;
+        for (uint8_t d = 1; d < Dim; ++d)
+            if (max[d] - min[d] > max[axis] - min[axis]) axis = d;
+
+        const size_t mid = lo + (hi - lo) / 2;
+        std::nth_element(nodes_.begin() + lo, nodes_.begin() + mid, nodes_.begin() + hi,
+            [axis](const node& a, const node& b) { return a.p[axis] < b.p[axis]; });
+        axes_[mid] = axis;
+
+        constexpr size_t min_parallel_points = 1 << 16;
+        if (threads > 1 && hi - lo >= min_parallel_points) {
+            std::thread left = internal::test_aware_thread([&] { build(lo, mid, threads / 2); });
+            build(mid + 1, hi, threads - threads / 2);
+            left.join();
+        } else {
+            build(lo, mid, 1);
+            build(mid + 1, hi, 1);
+        }
+    }
+
+    void nearest(const coords& q, size_t k, std::vector<std::pair<double, size_t>>& heap, std::vector<size_t>& result) const
+    {
+        heap.clear();
+        result.clear();
+        if (k == 0 || is_empty())
+            return;
+        search_nearest(0, nodes_.size(), q, k, heap);
+        std::sort_heap(heap.begin(), heap.end());
+        for (const auto& [d, index] : heap)
+            result.push_back(index);
+    }
+
+    // 'heap' is a max-heap of the k best (distance², index) pairs so far
+    void search_nearest(size_t lo, size_t hi, const coords& q, size_t k, std::vector<std::pair<double, size_t>>& heap) const
+    {
+        auto consider = [&](const node& n) {
+            const std::pair<double, size_t> candidate(distance2(n.p, q), n.index);
+            if (heap.size() < k) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (candidate < heap.front()) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        };
+
+        if (hi - lo <= leaf_size) {
+            for (size_t i = lo; i < hi; ++i) consider(nodes_[i]);
+            return;
+        }
+        const size_t mid   = lo + (hi - lo) / 2;
+        const double delta = q[axes_[mid]] - nodes_[mid].p[axes_[mid]];
+        consider(nodes_[mid]);
+        if (delta < 0) {
+            search_nearest(lo, mid, q, k, heap);
+            if (heap.size() < k || delta * delta <= heap.front().first)
+                search_nearest(mid + 1, hi, q, k, heap);
+        } else {
+            search_nearest(mid + 1, hi, q, k, heap);
+            if (heap.size() < k || delta * delta <= heap.front().first)
+                search_nearest(lo, mid, q, k, heap);
+        }
+    }
+
+    void search_within(size_t lo, size_t hi, const coords& q, double radius2, std::vector<size_t>& result) const
+    {
+        if (hi - lo <= leaf_size) {
+            for (size_t i = lo; i < hi; ++i)
+                if (distance2(nodes_[i].p, q) <= radius2) result.push_back(nodes_[i].index);
+            return;
+        }
+        const size_t mid   = lo + (hi - lo) / 2;
+        const double delta = q[axes_[mid]] - nodes_[mid].p[axes_[mid]];
+        if (distance2(nodes_[mid].p, q) <= radius2)
+            result.push_back(nodes_[mid].index);
+        if (delta <= 0 || delta * delta <= radius2)
+            search_within(lo, mid, q, radius2, result);
+        if (delta >= 0 || delta * delta <= radius2)
+            search_within(mid + 1, hi, q, radius2, result);
+    }
+
+    static constexpr size_t query_block = 256;
+
+    // Runs f(begin, end) over blocks of the queries, on threads for the parallel policies
+    template<class ExecutionPolicy, class F>
+    static void for_blocks(const ExecutionPolicy& policy, size_t n, F f)
+    {
+        if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+            if (n > query_block) {
+                internal::parallel_blocks<char>(n, 0, query_block, internal::as_parallel(policy).threads,
+                    [&](size_t begin, size_t end) -> char { f(begin, end); return 0; });
+                return;
+            }
+        }
+        for (size_t begin = 0; begin < n; begin += query_block)
+            f(begin, std::min(n, begin + query_block));
+    }
+
+    std::vector<node>    nodes_; // in tree order
+    std::vector<uint8_t> axes_;  // the split axis of the node at each position
+};
+
+using kd_tree2d = basic_kd_tree<2>;
+using kd_tree3d = basic_kd_tree<3>;
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::pool
+//
+// A memory resource of fixed-size blocks, carved out of larger chunks and recycled
+// through a free list, so that allocation and deallocation are a couple of pointer
+// moves. Made for node-based containers (zen::list, zen::map, ...), whose
+// allocations are all the size of a node. Larger or more aligned requests are
+// passed on to the upstream resource. Not thread-safe.
+// Example: zen::pool pool(48);
+//          zen::pmr::map<int, int> m(&pool);
+
+class pool : public std::pmr::memory_resource
+{
+public:
+    explicit pool(size_t block_size, size_t blocks_per_chunk = 1024,
+                  std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : block_size_(round_up(std::max(block_size, sizeof(free_block)), alignof(std::max_align_t)))
+        , blocks_per_chunk_(std::max<size_t>(1, blocks_per_chunk))
+        , upstream_(upstream) {}
+
+    pool(const pool&)            = delete;
+    pool& operator=(const pool&) = delete;
+
+    ~pool() override { release(); }
+
+    // Gives every chunk back to upstream, all blocks have to be deallocated by then
+    void release()
+    {
+        for (void* chunk : chunks_)
+            upstream_->deallocate(chunk, chunk_bytes(), alignof(std::max_align_t));
+        chunks_.clear();
+        free_ = nullptr;
+        stats_.bytes = 0;
+    }
+
+    size_t block_size() const { return block_size_; }
+
+    const allocation_stats& stats() const { return stats_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (bytes > block_size_ || alignment > alignof(std::max_align_t))
+            return upstream_->allocate(bytes, alignment);
+        if (!free_)
+            add_chunk();
+        free_block* b = free_;
+        free_ = b->next;
+        stats_.on_allocate(block_size_);
+        return b;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        if (bytes > block_size_ || alignment > alignof(std::max_align_t))
+            return upstream_->deallocate(p, bytes, alignment);
+        free_ = new (p) free_block{free_};
+        stats_.on_deallocate(block_size_);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& x) const noexcept override { return this == &x; }
+
+private:
+    struct free_block { free_block* next; };
+
+    static size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+    size_t chunk_bytes() const { return block_size_ * blocks_per_chunk_; }
+
+    // Threads the blocks of a new chunk onto the free list, in address order
+    void add_chunk()
+    {
+        auto* chunk = static_cast<std::byte*>(upstream_->allocate(chunk_bytes(), alignof(std::max_align_t)));
+        chunks_.push_back(chunk);
+        for (size_t i = blocks_per_chunk_; i-- > 0; )
+            free_ = new (chunk + i * block_size_) free_block{free_};
+    }
+
+    size_t                     block_size_;
+    size_t                     blocks_per_chunk_;
+    std::pmr::memory_resource* upstream_;
+    std::vector<void*>         chunks_;
+    free_block*                free_ = nullptr;
+    allocation_stats           stats_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::queue
+
+template<class T, class C = std::deque<T>>
+class queue : public std::queue<T, C>, private zen::stackonly
+{
+public:
+    using std::queue<T, C>::queue; // inherit constructors, has to be explicit
+
+    queue(const std::queue<T, C>& q) : std::queue<T, C>(q) {}
+    
+    template<class Iterable>
+    queue(const Iterable& c)
+    {
+        ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+
+        for (const auto& x : c)
+            my::push(x);
+    }
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = queue<T, C>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::priority_queue
+
+template<
+    class T,
+    class C = std::vector<T>,
+    class L = std::less<typename C::value_type>
+>
+class priority_queue : public std::priority_queue<T, C, L>, private zen::stackonly
+{
+public:
+    using std::priority_queue<T, C, L>::priority_queue; // inherit constructors, has to be explicit
+
+    priority_queue(const std::priority_queue<T, C, L>& q) : std::priority_queue<T, C, L>(q) {}
+
+    template<class Iterable>
+    priority_queue(const Iterable& c)
+    {
+        ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+
+        for (const auto& x : c)
+            my::push(x);
+    }
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = priority_queue<T, C, L>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::set
+
+template<class K, class C = std::less<K>, class A = std::allocator<K>>
+class set : public std::set<K, C, A>, private zen::stackonly
+{
+public:
+    using std::set<K, C, A>::set; // inherit constructors, has to be explicit
+
+    set(const std::set<K, C, A>& u) : std::set<K, C, A>(u) {}
+
+    template<class Kx, class Cx, class Ax>
+    set(const std::set<Kx, Cx, Ax>& u) : std::set<K, C, A>(u.begin(), u.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = set<K, C, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::multiset
+
+template<class K, class C = std::less<K>, class A = std::allocator<K>>
+class multiset : public std::multiset<K, C, A>, private zen::stackonly
+{
+public:
+    using std::multiset<K, C, A>::multiset; // inherit constructors, has to be explicit
+
+    multiset(const std::multiset<K, C, A>& u) : std::multiset<K, C, A>(u) {}
+
+    template<class Kx, class Cx, class Ax>
+    multiset(const std::multiset<Kx, Cx, Ax>& u) : std::multiset<K, C, A>(u.begin(), u.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = multiset<K, C, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::stack
+
+template<class T, class C = std::deque<T>>
+class stack : public std::stack<T, C>, private zen::stackonly
+{
+public:
+    using std::stack<T, C>::stack; // inherit constructors, has to be explicit
+
+    stack(const std::stack<T, C>& q) : std::stack<T, C>(q) {}
+        
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = stack<T, C>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::string
+
+namespace internal {
+    // Fills [dst, dst + n) with back-to-back copies of the pattern, truncating the last one.
+    // The pattern is copied once and the filled prefix is then doubled, so a fill takes
+    // O(log(n / pattern.size())) memcpy calls instead of one append per repetition.
+    inline void fill_pattern(char* dst, size_t n, const std::string_view pattern)
+    {
+        if (n == 0 || pattern.empty()) return;
+
+        size_t filled = std::min(n, pattern.size());
+        std::memcpy(dst, pattern.data(), filled);
+        while (filled < n) {
+            const size_t chunk = std::min(filled, n - filled);
+            std::memcpy(dst + filled, dst, chunk); // never overlaps since chunk <= filled
+            filled += chunk;
+        }
+    }
+
+    // Both padding helpers grow the string to its final size with
+    // a single resize and then fill the gap in place, so they cost
+    // at most one allocation regardless of the amount of padding.
+    template<class S>
+    void pad_start(S& s, size_t target_length, const std::string_view pad_string)
+    {
+        const size_t current_length = s.size();
+        if (pad_string.empty() || target_length <= current_length) return;
+
+        const size_t padding = target_length - current_length;
+        s.resize(target_length);
+        std::memmove(s.data() + padding, s.data(), current_length);
+        fill_pattern(s.data(), padding, pad_string);
+    }
+
+    template<class S>
+    void pad_end(S& s, size_t target_length, const std::string_view pad_string)
+    {
+        const size_t current_length = s.size();
+        if (pad_string.empty() || target_length <= current_length) return;
+
+        s.resize(target_length);
+        fill_pattern(s.data() + current_length, target_length - current_length, pad_string);
+    }
+    // The helpers zen::string and zen::arena_string have in common, written once against
+    // the std::basic_string they derive from. Strings the helpers return are allocated
+    // like the string they come from, so those of an arena_string stay in its arena.
+    template<class Derived, class String>
+    class string_helpers
+    {
+    public:
+        using string_list = std::vector<Derived, typename std::allocator_traits<typename String::allocator_type>::template rebind_alloc<Derived>>;
+
+#if __cplusplus < 202303L // check pre-C++23, at which point std::string::contains() is standard
+        // SFINAE to ensure that this version is only enabled when Pred is callable
+        template<class Pred, typename = std::enable_if_t<std::is_invocable_r_v<bool, Pred, char>>>
+        bool contains(const Pred& p)            const { return std::find_if(str().begin(), str().end(), p) != str().end(); }
+        bool contains(const std::string_view s) const { return str().find(s) != String::npos; }
+#endif
+
+        bool is_empty() const { return str().empty(); }
+
+        std::string_view view() const { return std::string_view(str().data(), str().size()); }
+
+        // std::string s = "[EXTRACTME]";
+        //                   ^^^^^^^^^
+        // Example: s.extract_between("[", "]");
+        Derived extract_between(const std::string_view beg, const std::string_view end) const
+        {
+            const size_t posBeg = str().find(beg);
+            if (posBeg == String::npos) return same_kind(""); // signals 'not found'
+            const size_t posEnd = str().find(end, posBeg + 1);
+            if (posEnd == String::npos) return same_kind(""); // signals 'not found'
+            return same_kind(view().substr(posBeg + 1, posEnd - posBeg - 1));
+        }
+
+        // Modifying functions
+        Derived& prefix(const std::string_view s)
+        {
+            str().insert(0, s);
+            return self();
+        }
+
+        // Behaves like JavaScript's string.replace()
+        Derived& replace(const std::string_view search, const std::string_view replacement)
+        {
+            const size_t position = str().find(search);
+            if (position != String::npos) {
+                str().replace(position, search.length(), replacement);
+            }
+            return self();
+        }
+
+        template <typename Pred>
+        Derived& replace_if(const std::string_view search, const std::string_view replacement, Pred predicate)
+        {
+            if (search.empty()) return self();
+
+            static_assert(std::is_invocable<Pred, const Derived&>(),
+                "TEMPLATE PARAMETER Pred MUST BE CALLABLE WITH THE STRING, BUT IS NOT");
+            static_assert(std::is_same_v<std::invoke_result_t<Pred, const Derived&>, bool>,
+                "TEMPLATE PARAMETER Pred MUST RETURN bool, BUT DOES NOT");
+
+            const size_t position = str().find(search);
+            if (position != String::npos && predicate(self())) {
+                str().replace(position, search.length(), replacement);
+            }
+            return self();
+        }
+
+        // Behaves like JavaScript's string.replaceAll()
+        Derived& replace_all(const std::string_view search, const std::string_view replacement)
+        {
+            if (search.empty()) return self();
+
+            size_t pos = 0;
+            while ((pos = str().find(search, pos)) != String::npos) {
+                str().replace(pos, search.length(), replacement);
+                pos += replacement.length(); // move pos forward by the length of replace to prevent infinite loops
+            }
+            return self();
+        }
+
+        template <typename Pred>
+        Derived& replace_all_if(const std::string_view search, const std::string_view replacement, Pred predicate)
+        {
+            if (search.empty()) return self();
+
+            static_assert(std::is_invocable<Pred, const Derived&>(),
+                "TEMPLATE PARAMETER Pred MUST BE CALLABLE WITH THE STRING, BUT IS NOT");
+            static_assert(std::is_same_v<std::invoke_result_t<Pred, const Derived&>, bool>,
+                "TEMPLATE PARAMETER Pred MUST RETURN bool, BUT DOES NOT");
+
+            size_t pos = 0;
+            while ((pos = str().find(search, pos)) != String::npos) {
+                if (predicate(self())) {
+                    str().replace(pos, search.length(), replacement);
+                    pos += replacement.length(); // move pos forward by the length of replace to prevent infinite loops
+                } else {
+                    pos += search.length(); // move pos forward by the length of search
+                }
+            }
+            return self();
+        }
+
+        Derived& trim_from_last(const std::string_view s)
+        {
+            const size_t pos = str().rfind(s);
+            if (pos != String::npos) str().erase(pos);
+            return self();
+        }
+
+        // Trim leading and trailing spaces
+        Derived& trim() { return rtrim().ltrim(); }
+
+        bool is_trimmed() const
+        {
+            return !is_empty() && !::isspace(str().front()) && !::isspace(str().back());
+        }
+
+        // Replace any & all multiple spaces with a single space, after trimming.
+        // Done in place: every character moves at most once, nothing is allocated.
+        Derived& deflate()
+        {
+            trim();
+            auto out = str().begin();
+            bool in_space = false;
+            for (const char c : str()) {
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    if (!in_space) *out++ = ' ';
+                    in_space = true;
+                } else {
+                    *out++ = c;
+                    in_space = false;
+                }
+            }
+            str().erase(out, str().end());
+            return self();
+        }
+
+        bool is_deflated() const
+        {
+            auto neighbor_spaces = [](char a, char b) { return std::isspace(a) && std::isspace(b); };
+            return str().end() == std::adjacent_find(str().begin(), str().end(), neighbor_spaces);
+        }
+
+        Derived substring(int i1, int i2) const
+        {
+            const int sz = static_cast<int>(str().size());
+
+            // If necessary, convert negative indices to positive
+            if (i1 < 0) i1 += sz;
+            if (i2 < 0) i2 += sz;
+
+            // Clamp indices to valid range
+            i1 = std::clamp<int>(i1, 0, sz);
+            i2 = std::clamp<int>(i2, 0, sz);
+
+            if (i2 <= i1) {
+                return same_kind(""); // empty string signals a negative result and is harmless
+            }
+
+            return same_kind(view().substr(i1, i2 - i1));
+        }
+
+        Derived& pad_start(size_t target_length, const std::string_view pad_string = " ")
+        {
+            internal::pad_start(str(), target_length, pad_string);
+            return self();
+        }
+
+        Derived& pad_end(size_t target_length, const std::string_view pad_string = " ")
+        {
+            internal::pad_end(str(), target_length, pad_string);
+            return self();
+        }
+
+        Derived& capitalize()
+        {
+            if (is_empty()) return self();
+
+            if (std::isalpha(str().front()) && std::islower(str().front())) {
+                str().front() = static_cast<char>(std::toupper(str().front())); // capitalize the first character
+            }
+
+            for (size_t i = 1; i < str().size(); ++i) {
+                char& c = str()[i];
+                if (std::isalpha(c) && std::isupper(c)) {
+                    c = static_cast<char>(std::tolower(c));
+                }
+            }
+
+            return self();
+        }
+
+        Derived& to_lower() {
+            for (auto& c : str()) {
+                if (std::isalpha(c) && std::isupper(c)) {
+                    c = static_cast<char>(std::tolower(c));
+                }
+            }
+            return self();
+        }
+
+        Derived& to_upper() {
+            for (auto& c : str()) {
+                if (std::isalpha(c) && std::islower(c)) {
+                    c = static_cast<char>(std::toupper(c));
+                }
+            }
+            return self();
+        }
+
+        Derived& center(size_t width, char fillchar = ' ') {
+            if (width <= str().size()) return self();
+
+            const size_t padding = width - str().size();
+            const size_t left_padding  = padding / 2;
+            const size_t right_padding = padding - left_padding;
+
+            str().insert(0, left_padding, fillchar);
+            str().append(right_padding, fillchar);
+
+            return self();
+        }
+
+        bool is_printable() const { return                std::all_of(str().begin(), str().end(), [](auto c) { return std::isprint(c); }); }
+        bool is_alnum()     const { return !is_empty() && std::all_of(str().begin(), str().end(), [](auto c) { return std::isalnum(c); }); }
+        bool is_alpha()     const { return !is_empty() && std::all_of(str().begin(), str().end(), [](auto c) { return std::isalpha(c); }); }
+        bool is_digit()     const { return !is_empty() && std::all_of(str().begin(), str().end(), [](auto c) { return std::isdigit(c); }); }
+        bool is_lower()     const { return !is_empty() && std::all_of(str().begin(), str().end(), [](auto c) { return std::islower(c); }); }
+        bool is_upper()     const { return !is_empty() && std::all_of(str().begin(), str().end(), [](auto c) { return std::isupper(c); }); }
+        bool is_space()     const { return !is_empty() && std::all_of(str().begin(), str().end(), [](auto c) { return std::isspace(c); }); }
+
+        bool is_identifier() const
+        {
+            if (is_empty())
+                return false;
+
+            if (!std::isalpha(str().front()) && str().front() != '_')
+                return false;
+
+            for (size_t i = 1; i < str().size(); ++i) {
+                const char& c = str()[i];
+                if (!std::isalnum(c) && c != '_') {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        Derived& ljust(int width, char fillchar = ' ')
+        {
+            if (width < 0)
+                width = 0; // handle negative width gracefully
+
+            auto uwidth = static_cast<size_t>(width);
+            if (uwidth <= str().size())
+                return self();
+
+            const size_t padding = uwidth - str().size();
+            str().append(padding, fillchar);
+
+            return self();
+        }
+
+        Derived& rjust(int width, char fillchar = ' ')
+        {
+            if (width < 0)
+                width = 0; // handle negative width gracefully
+
+            auto uwidth = static_cast<size_t>(width);
+            if (uwidth <= str().size())
+                return self();
+
+            const size_t padding = uwidth - str().size();
+            str().insert(0, padding, fillchar);
+
+            return self();
+        }
+
+        Derived& rtrim()
+        {
+            str().erase(
+                std::find_if(str().rbegin(), str().rend(),
+                    [](int c) { return !std::isspace(c); }
+                ).base(),
+                str().end()
+            );
+            return self();
+        }
+
+        Derived& ltrim()
+        {
+            str().erase(
+                str().begin(),
+                std::find_if(str().begin(), str().end(), [](int c) { return !std::isspace(c); })
+            );
+            return self();
+        }
+
+        auto partition(const std::string_view separator) const
+        {
+            if (separator.empty())
+                throw std::invalid_argument("STRING SEPARATOR CANNOT BE EMPTY");
+
+            return partition_at(str().find(separator), separator.length());
+        }
+
+        auto rpartition(const std::string_view separator) const
+        {
+            if (separator.empty())
+                throw std::invalid_argument("STRING SEPARATOR CANNOT BE EMPTY");
+
+            return partition_at(str().rfind(separator), separator.length());
+        }
+
+        string_list split(const std::string_view separator) const
+        {
+            if (separator.empty())
+                throw std::invalid_argument("STRING SEPARATOR CANNOT BE EMPTY");
+
+            string_list result(str().get_allocator());
+            const std::string_view sv = view();
+            size_t from = 0, pos = 0;
+            while ((pos = sv.find(separator, from)) != std::string_view::npos) {
+                result.push_back(same_kind(sv.substr(from, pos - from)));
+                from = pos + separator.length();
+            }
+            result.push_back(same_kind(sv.substr(from)));
+            return result;
+        }
+
+        // Like std::getline() in a loop: a last line without '\n' counts, an empty one doesn't
+        string_list split_lines() const
+        {
+            string_list lines(str().get_allocator());
+            const std::string_view sv = view();
+            size_t from = 0, pos = 0;
+            while ((pos = sv.find('\n', from)) != std::string_view::npos) {
+                lines.push_back(same_kind(sv.substr(from, pos - from)));
+                from = pos + 1;
+            }
+            if (from < sv.size())
+                lines.push_back(same_kind(sv.substr(from)));
+            return lines;
+        }
+
+        Derived& swapcase()
+        {
+            for (auto& c : str()) {
+                if (std::isalpha(c)) {
+                    c = std::islower(c) ? static_cast<char>(std::toupper(c)) : static_cast<char>(std::tolower(c));
+                }
+            }
+            return self();
+        }
+
+        bool is_ascii() const
+        {
+            for (char c : str())
+                if (!isascii(c))
+                    return false;
+            return true;
+        }
+
+    private:
+        Derived&       self()       { return static_cast<Derived&>(*this); }
+        const Derived& self() const { return static_cast<const Derived&>(*this); }
+        String&        str()        { return static_cast<String&>(self()); }
+        const String&  str()  const { return static_cast<const String&>(self()); }
+
+        // A new string with the allocator of this one
+        Derived same_kind(const std::string_view s) const { return Derived(s, str().get_allocator()); }
+
+        std::tuple<std::string_view, std::string_view, std::string_view> partition_at(size_t pos, size_t length) const
+        {
+            const std::string_view sv = view();
+            if (pos == String::npos)
+                return std::make_tuple(sv, std::string_view(), std::string_view());
+
+            const std::string_view before = sv.substr(0, pos);
+            const std::string_view after  = sv.substr(pos + length);
+            const std::string_view sep    = sv.substr(pos,  length);
+
+            return std::make_tuple(before, sep, after);
+        }
+    };
+} // namespace internal
+
+class string : public std::string, public internal::string_helpers<zen::string, std::string>, private zen::stackonly
+{
+public:
+    using std::string::string;    // inherit constructors,         has to be explicit
+    using std::string::operator=; // inherit assignment operators, has to be explicit
+
+    string(const std::string&     s) : std::string(s) {}
+    string(const std::string_view s) : std::string(s) {}
+
+    // Both bases have these, the helpers take precedence as before
+#if __cplusplus < 202303L
+    using string_helpers::contains;
+#endif
+    using string_helpers::replace;
+
+    zen::string extract_pattern(const std::string& pattern)
+    {
+        const std::regex regex_pattern(pattern);
+        std::smatch match;
+        std::string in(my::begin(), my::end());
+
+        if (std::regex_search(in,   match, regex_pattern)) {
+            const size_t startPos = match.position(0);
+            const size_t length   = match.length(0);
+
+            // Create a sub-string_view using the position and length
+            return std::string(my::data() + startPos, length);
+        }
+
+        return ""; // signals 'no match'
+    }
+
+    zen::string& remove(const std::string& pattern)
+    {
+        *this = std::regex_replace(*this, std::regex(pattern), std::string(""));
+        return *this; // for natural chaining
+    }
+
+    auto extract_version()   { return extract_pattern(R"((\d+)\.(\d+)\.(\d+)\.(\d+))"                          ); } // Like "X.Y.Z.B"
+    auto extract_date()      { return extract_pattern(R"((\d+\/\d+\/\d+))"                                     ); } // Like "31/12/2021"
+    auto extract_email()     { return extract_pattern(R"((\b[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\.[A-Za-z]{2,}\b))"); }
+    auto extract_url()       { return extract_pattern(R"((https?://[^\s]+))"                                   ); }
+    auto extract_hashtag()   { return extract_pattern(R"((#\w+))"                                              ); } // Like "#event"
+    auto extract_extension() { return extract_pattern(R"((\.\w+$))"                                            ); }
+
+private:
+    using my = zen::string;
+};
+
+struct string_hash {
+    size_t operator()(const zen::string& z) const {
+        return std::hash<std::string>()(z);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::arena_string
+
+// A zen::string counterpart for hot parsing code. Its memory comes from a
+// std::pmr::memory_resource, normally the arena of a zen::string_builder,
+// so building and modifying it costs no trips to the global heap. Short
+// contents still fit in the small-string buffer and allocate nothing.
+// It has every zen::string helper except the regex-based extract_* and
+// remove(); those that return strings allocate them from the same resource.
+// Example: zen::string_builder sb(buffer, sizeof(buffer));
+//          auto field = sb.make("  value ");
+//          field.trim().to_upper().pad_end(10, ".");
+// Result:  "VALUE....."
+class arena_string : public std::pmr::string, public internal::string_helpers<arena_string, std::pmr::string>, private zen::stackonly
+{
+public:
+    using std::pmr::string::basic_string; // inherit constructors,         has to be explicit
+    using std::pmr::string::operator=;    // inherit assignment operators, has to be explicit
+
+    arena_string(const std::string_view s, const allocator_type& a) : std::pmr::string(s, a) {}
+
+#if __cplusplus < 202303L
+    using string_helpers::contains;
+#endif
+    using string_helpers::replace;
+};
+
+// Owns a monotonic arena, preferably over a caller-supplied buffer, and hands out
+// zen::arena_string objects allocated from it. Allocation is a pointer bump and
+// reset() discards everything at once, so a parser can reuse the same memory for
+// every record. Strings made before a reset() must not be touched after it.
+// Example: alignas(64) char buffer[4096];
+//          zen::string_builder sb(buffer, sizeof(buffer));
+//          for (const auto& line : lines) {
+//              auto fields = sb.make(line).split(",");
+//              ...
+//              sb.reset();
+//          }
+class string_builder : private zen::stackonly
+{
+public:
+    // Once the buffer is exhausted the arena keeps growing from the upstream resource
+    string_builder(void* buffer, size_t size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : arena_(buffer, size, upstream) {}
+
+    explicit string_builder(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : arena_(upstream) {}
+
+    string_builder(const string_builder&)            = delete;
+    string_builder& operator=(const string_builder&) = delete;
+
+    arena_string make(const std::string_view s = "") { return arena_string(s, &arena_); }
+
+    // For allocating other pmr types (e.g. std::pmr::vector) from the same arena
+    std::pmr::memory_resource* resource() { return &arena_; }
+
+    // Constant time while the caller-supplied buffer was enough, otherwise
+    // one deallocation per chunk that had to come from the upstream resource
+    void reset() { arena_.release(); }
+
+private:
+    std::pmr::monotonic_buffer_resource arena_;
+};
+
+template <class Rep, class Period>
+std::string adaptive_duration(const std::chrono::duration<Rep, Period>& d)
+{
+    using namespace std::chrono;
+
+    auto duration_ns = duration_cast<nanoseconds>(d).count();
+
+    if (duration_ns >= 3600e9) return std::to_string(duration_cast<hours>       (d).count()) + " hours";
+    if (duration_ns >=   60e9) return std::to_string(duration_cast<minutes>     (d).count()) + " minutes";
+    if (duration_ns >=    1e9) return std::to_string(duration_cast<seconds>     (d).count()) + " seconds";
+    if (duration_ns >=    1e6) return std::to_string(duration_cast<milliseconds>(d).count()) + " milliseconds";
+    if (duration_ns >=    1e3) return std::to_string(duration_cast<microseconds>(d).count()) + " microseconds";
+
+    return std::to_string(duration_ns) + " nanoseconds";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::timer
+
+// Clocks for basic_timer besides the standard ones. std::chrono::high_resolution_clock
+// isn't among the recommended ones, as some standard libraries alias it to the
+// system_clock, which jumps whenever the wall time is adjusted.
+
+// CLOCK_MONOTONIC_RAW on Linux: like the steady_clock (CLOCK_MONOTONIC), but never
+// slewed by NTP, so short intervals aren't stretched or shrunk while the system time
+// is being corrected. Other systems get the steady_clock under this name.
+struct monotonic_raw_clock {
+    using duration   = std::chrono::nanoseconds;
+    using rep        = duration::rep;
+    using period     = duration::period;
+    using time_point = std::chrono::time_point<monotonic_raw_clock>;
+
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+#if defined(__linux__)
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return time_point(duration(static_cast<rep>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec));
+#else
+        return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()));
+#endif
+    }
+};
+
+// The time stamp counter of x86 CPUs, read with a single rdtsc: the cheapest
+// clock there is (a few nanoseconds per reading, against the 20 or so of a
+// clock_gettime() call). Ticks are converted to nanoseconds with a frequency
+// calibrated against the steady_clock on first use, which takes 10 ms, and counted
+// from the tick count of the calibration, so that the conversion to double doesn't
+// round away the nanoseconds of a counter that has been running for days. It assumes
+// an invariant TSC, one that ticks at a constant rate in every power state and
+// on every core, as on all x86 CPUs of the last decade. Other CPUs get the
+// steady_clock under this name.
+struct tsc_clock {
+    using duration   = std::chrono::nanoseconds;
+    using rep        = duration::rep;
+    using period     = duration::period;
+    using time_point = std::chrono::time_point<tsc_clock>;
+
+    static constexpr bool is_steady = true;
+
+    // The raw counter, for the cheapest readings of all
+    static uint64_t ticks() noexcept
+    {
+#if ZEN_SIMD_X86
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    static double nanoseconds_per_tick() { return calibration().ratio; }
+
+    // Nanoseconds since the calibration
+    static time_point now() noexcept
+    {
+        static const calibrated c = calibration(); // before the first reading
+        // Signed, for a core whose counter lags the calibrating one by a few ticks
+        return time_point(duration(static_cast<rep>(static_cast<double>(static_cast<int64_t>(ticks() - c.base)) * c.ratio)));
+    }
+
+private:
+    struct calibrated {
+        double   ratio; // nanoseconds per tick
+        uint64_t base;  // tick count at the calibration, the epoch of now()
+    };
+
+    static const calibrated& calibration()
+    {
+        static const calibrated c = [] {
+#if ZEN_SIMD_X86
+            using namespace std::chrono;
+            const auto     t0 = steady_clock::now();
+            const uint64_t c0 = ticks();
+            auto t1 = t0;
+            while ((t1 = steady_clock::now()) - t0 < milliseconds(10)) {}
+            const uint64_t c1 = ticks();
+            return calibrated{ static_cast<double>(duration_cast<nanoseconds>(t1 - t0).count()) / static_cast<double>(c1 - c0), c0 };
+#else
+            return calibrated{ static_cast<double>(std::chrono::steady_clock::period::num) * 1e9 / std::chrono::steady_clock::period::den, ticks() };
+#endif
+        }();
+        return c;
+    }
+};
+
+// A stopwatch on any clock, by default the steady_clock
+// Example: zen::timer t;            // starts on construction
+//          load_data();
+//          auto load = t.lap();    // since the start
+//          process_data();
+//          auto work = t.lap();    // since the previous lap
+//          t.stop();
+//          zen::log(t.duration_string(), "in total, laps:", t.laps().size());
+// lap() records every lap in a std::vector, so reserve_laps() before the timed
+// region keeps it from allocating there. start() keeps the reserved space.
+template<class Clock = std::chrono::steady_clock>
+class basic_timer {
+public:
+    using clock      = Clock;
+    using time_point = typename Clock::time_point;
+
+    using nsec = std::chrono::nanoseconds;
+    using usec = std::chrono::microseconds;
+    using msec = std::chrono::milliseconds;
+    using sec  = std::chrono::seconds;
+    using min  = std::chrono::minutes;
+    using hrs  = std::chrono::hours;
+  //using d    = std::chrono::days;   // since C++20
+  //using w    = std::chrono::weeks;  // since C++20
+  //using m    = std::chrono::months; // since C++20
+  //using y    = std::chrono::years;  // since C++20
+
+    basic_timer() : start_(Clock::now()), stop_(start_), lap_(start_) {}
+
+    basic_timer& start() { start_ = lap_ = stop_ = Clock::now(); laps_.clear(); return *this; }
+    basic_timer& stop()  { stop_ = Clock::now(); return *this; }
+
+    // Time since the start, without stopping
+    template<class Duration = nsec>
+    Duration elapsed() const {
+        return std::chrono::duration_cast<Duration>(Clock::now() - start_);
+    }
+
+    // Also time since the start, under its stopwatch name
+    template<class Duration = nsec>
+    Duration split() const {
+        return elapsed<Duration>();
+    }
+
+    // Time since the previous lap (or the start), recorded in laps(). Allocates when
+    // there are more laps than reserve_laps() made room for.
+    template<class Duration = nsec>
+    Duration lap() {
+        const time_point now = Clock::now();
+        laps_.push_back(now - lap_);
+        lap_ = now;
+        return std::chrono::duration_cast<Duration>(laps_.back());
+    }
+
+    const std::vector<typename Clock::duration>& laps() const { return laps_; }
+
+    basic_timer& reserve_laps(size_t n) { laps_.reserve(n); return *this; }
+
+    // Time from the start to the stop
+    template<class Duration = nsec>
+    Duration duration() const {
+        return std::chrono::duration_cast<Duration>(stop_ - start_);
+    }
+
+    // Same, without the overhead() of the timer itself
+    template<class Duration = nsec>
+    Duration net_duration() const {
+        return std::chrono::duration_cast<Duration>(std::max(stop_ - start_ - overhead(), Clock::duration::zero()));
+    }
+
+    auto duration_string() const {
+        return adaptive_duration(duration<nsec>());
+    }
+
+    // What a measurement of nothing reads on this clock: the median of many back to
+    // back readings, measured once per clock. Subtracting it matters for intervals
+    // of no more than a few microseconds.
+    static typename Clock::duration overhead() {
+        static const typename Clock::duration median = [] {
+            constexpr size_t readings = 1001;
+            std::array<typename Clock::duration, readings> d;
+            for (auto& x : d) {
+                const time_point a = Clock::now();
+                const time_point b = Clock::now();
+                x = b - a;
+            }
+            std::nth_element(d.begin(), d.begin() + readings / 2, d.end());
+            return d[readings / 2];
+        }();
+        return median;
+    }
+
+private:
+    time_point start_;
+    time_point stop_;
+    time_point lap_;
+    std::vector<typename Clock::duration> laps_;
+};
+
+using timer = basic_timer<>;
+
+// ------------------------------------------------------------------------------------------ benchmarking
+
+namespace internal {
+    // Where do_not_optimize() publishes values on compilers without GCC-style inline asm
+    inline const volatile char* volatile benchmark_sink = nullptr;
+} // namespace internal
+
+// Makes the compiler assume that 'value' is read (and, for the non-const overload,
+// modified) by something it can't see, so the computation producing it can't be
+// optimized away and the value can't be hoisted out of a measured loop.
+// Example: zen::measure_execution([&] { zen::do_not_optimize(zen::sum(v)); });
+template<class T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    internal::benchmark_sink = &reinterpret_cast<const volatile char&>(value);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+template<class T>
+inline void do_not_optimize(T& value)
+{
+#if defined(__clang__)
+    asm volatile("" : "+r,m"(value) : : "memory");
+#elif defined(__GNUC__)
+    asm volatile("" : "+m,r"(value) : : "memory");
+#else
+    internal::benchmark_sink = &reinterpret_cast<const volatile char&>(value);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Makes the compiler assume that all of memory is read and written at this point,
+// so stores before it are really performed, not merged or dropped as dead
+// Example: std::fill(v.begin(), v.end(), 0);
+//          zen::clobber_memory();
+inline void clobber_memory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// The durations of repeated runs of the same operation, and their statistics
+template<class Duration>
+struct execution_stats {
+    std::vector<Duration> samples; // in run order
+    Duration min{};
+    Duration max{};
+    Duration mean{};
+    Duration median{};
+    Duration stddev{};
+
+    size_t runs() const { return samples.size(); }
+};
+
+namespace internal {
+    template<class Duration>
+    execution_stats<Duration> make_execution_stats(std::vector<Duration> samples)
+    {
+        execution_stats<Duration> s;
+        s.samples = std::move(samples);
+        if (s.samples.empty())
+            return s;
+
+        std::vector<Duration> sorted = s.samples;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t n = sorted.size();
+        s.min    = sorted.front();
+        s.max    = sorted.back();
+        s.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+        double mean = 0;
+        for (const Duration& d : sorted) mean += static_cast<double>(d.count());
+        mean /= static_cast<double>(n);
+        double variance = 0;
+        for (const Duration& d : sorted) variance += (static_cast<double>(d.count()) - mean) * (static_cast<double>(d.count()) - mean);
+        variance /= static_cast<double>(n > 1 ? n - 1 : 1);
+        s.mean   = Duration(static_cast<typename Duration::rep>(mean));
+        s.stddev = Duration(static_cast<typename Duration::rep>(std::sqrt(variance)));
+        return s;
+    }
+
+    // Runs the operation once, keeping its result (if any) alive
+    template<class Operation>
+    inline void run_measured(Operation& operation)
+    {
+        if constexpr (std::is_void_v<std::invoke_result_t<Operation&>>)
+            operation();
+        else
+            do_not_optimize(operation());
+        clobber_memory();
+    }
+} // namespace internal
+
+// Measures how long a single run of 'operation' takes. Any callable is accepted
+// and called directly, without the allocation and the indirect call of a
+// std::function in the measured region. A result it returns is passed to
+// do_not_optimize(), so the work producing it can't be optimized away.
+// Example: auto ns = zen::measure_execution([&] { return zen::sum(v); });
+template<class Duration = timer::nsec, class Operation>
+Duration measure_execution(Operation&& operation)
+{
+    timer t;
+    t.start();
+    internal::run_measured(operation);
+    t.stop();
+    return t.duration<Duration>();
+}
+
+// Measures 'runs' runs of 'operation', each timed on its own, and returns their
+// statistics. Reading the median and the min rather than a single run filters
+// out most of the noise of interrupts, frequency scaling and cold caches.
+// Example: auto stats = zen::measure_execution<zen::timer::usec>([&] { return zen::sum(v); }, 100);
+//          zen::log("median", stats.median.count(), "us, stddev", stats.stddev.count(), "us");
+template<class Duration = timer::nsec, class Operation>
+execution_stats<Duration> measure_execution(Operation&& operation, size_t runs)
+{
+    std::vector<Duration> samples;
+    samples.reserve(runs);
+    timer t;
+    for (size_t i = 0; i < runs; ++i) {
+        t.start();
+        internal::run_measured(operation);
+        t.stop();
+        samples.push_back(t.duration<Duration>());
+    }
+    return internal::make_execution_stats(std::move(samples));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_map
+
+template<
+    class K,
+    class V,
+    class H = std::hash<K>,
+    class E = std::equal_to<K>,
+    class A = std::allocator<std::pair<const K, V>>
+>
+class unordered_map : public std::unordered_map<K, V, H, E, A>, private zen::stackonly
+{
+public:
+    using std::unordered_map<K, V, H, E, A>::unordered_map; // inherit constructors, has to be explicit
+
+    unordered_map(const std::unordered_map<K, V, H, E, A>& u)
+        : std::unordered_map<K, V, H, E, A>(u) {}
+
+    template<class Kx, class Vx, class Hx, class Ex, class Ax>
+    unordered_map(const std::unordered_map<Kx, Vx, Hx, Ex, Ax>& u)
+        : std::unordered_map<K, V, H, E, A>(u.begin(), u.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = unordered_map<K, V, H, E, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_multimap
+
+template<
+    class K,
+    class V,
+    class H = std::hash<K>,
+    class E = std::equal_to<K>,
+    class A = std::allocator<std::pair<const K, V>>
+>
+class unordered_multimap : public std::unordered_multimap<K, V, H, E, A>, private zen::stackonly
+{
+public:
+    using std::unordered_multimap<K, V, H, E, A>::unordered_multimap; // inherit constructors, has to be explicit
+
+    unordered_multimap(const std::unordered_multimap<K, V, H, E, A>& u)
+        : std::unordered_multimap<K, V, H, E, A>(u) {}
+
+    template<class Kx, class Vx, class Hx, class Ex, class Ax>
+    unordered_multimap(const std::unordered_multimap<Kx, Vx, Hx, Ex, Ax>& u)
+        : std::unordered_multimap<K, V, H, E, A>(u.begin(), u.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = unordered_multimap<K, V, H, E, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_set
+
+template<
+    class T,
+    class H = std::hash<T>,
+    class E = std::equal_to<T>,
+    class A = std::allocator<T>
+>
+class unordered_set : public std::unordered_set<T, H, E, A>, private zen::stackonly
+{
+public:
+    using std::unordered_set<T, H, E, A>::unordered_set; // inherit constructors, has to be explicit
+
+    unordered_set(const std::unordered_set<T, H, E, A>& u)
+        : std::unordered_set<T, H, E, A>(u) {}
+
+    template<class Tx, class Hx, class Ex, class Ax>
+    unordered_set(const std::unordered_set<Tx, Hx, Ex, Ax>& u)
+        : std::unordered_set<T, H, E, A>(u.begin(), u.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = unordered_set<T, H, E, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_multiset
+
+template<
+    class T,
+    class H = std::hash<T>,
+    class E = std::equal_to<T>,
+    class A = std::allocator<T>
+>
+class unordered_multiset : public std::unordered_multiset<T, H, E, A>, private zen::stackonly
+{
+public:
+    using std::unordered_multiset<T, H, E, A>::unordered_multiset; // inherit constructors, has to be explicit
+
+    unordered_multiset(const std::unordered_multiset<T, H, E, A>& u)
+        : std::unordered_multiset<T, H, E, A>(u) {}
+
+    template<class Tx, class Hx, class Ex, class Ax>
+    unordered_multiset(const std::unordered_multiset<Tx, Hx, Ex, Ax>& u)
+        : std::unordered_multiset<T, H, E, A>(u.begin(), u.end()) {}
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = unordered_multiset<T, H, E, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::vector
+
+template<class T, class A = std::allocator<T>>
+class vector : public std::vector<T, A>, private zen::stackonly
+{
+public:
+    using std::vector<T, A>::vector; // inherit constructors, has to be explicit
+
+    vector(const std::vector<T, A>& v) : std::vector<T, A>(v) {}
+
+    template<class Pred>
+    typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
+        contains(Pred p) const
+    {
+        return std::find_if(my::begin(), my::end(), p) != my::end();
+    }
+
+    // Arithmetic elements are scanned with the vectorized kernel of the SIMD section.
+    // For many queries on the same vector, see zen::indexed_vector (INDEXING).
+    bool contains(const T& x) const
+    {
+        if constexpr (internal::simd::is_countable_v<T>)
+            return internal::simd::contains(my::data(), my::size(), x);
+        else
+            return std::find(my::begin(), my::end(), x) != my::end();
+    }
+
+    // Splits the search over threads when the container is large, see PARALLEL
+    // Example: v.contains(zen::execution::par, 42);
+    template<class ExecutionPolicy, class X>
+    typename std::enable_if<execution::is_execution_policy_v<ExecutionPolicy>, bool>::type
+        contains(ExecutionPolicy&& policy, const X& x) const
+    {
+        if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>)
+            return internal::parallel_contains(internal::as_parallel(policy), *this, x);
+        else
+            return contains(x);
+    }
+
+    bool is_empty() const { return my::empty(); }
+
+private:
+    using my = vector<T, A>;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// INDEXING
+//
+// zen::indexed wraps a zen::vector or a zen::deque for code that keeps asking the same
+// container whether it contains things. Its contains(x) answers from a companion index,
+// built on the first query and again on the first query after a change. Elements can
+// only be read in place: every change goes through a member of the wrapper, which
+// marks the index dirty, so a query never sees a stale one. set() writes one element
+// and modify() hands a function the whole container. Like the containers, an indexed
+// one isn't safe to query from several threads at once, as queries may build the index.
+// The plain containers carry no index and pay nothing for it.
+// Example: zen::indexed_vector<std::string> names = {"ada", "alan"};
+//          for (const auto& s : queries)
+//              if (names.contains(s)) ... // O(1) on average instead of a linear scan
+//          names.push_back("grace");      // the next contains() rebuilds the index
+//          names.set(0, "barbara");
+//          names.modify([](auto& v) { std::sort(v.begin(), v.end()); });
+
+namespace internal {
+
+// A hash set of the elements when T is hashable, a sorted copy for binary search
+// when T only has <, built by contains() when there is none
+template<class T>
+class membership_index {
+public:
+    membership_index() = default;
+
+    // Copies don't take the index along, the copy builds its own on demand
+    membership_index(const membership_index&) noexcept {}
+    membership_index& operator=(const membership_index&) noexcept
+    {
+        invalidate();
+        return *this;
+    }
+
+    void invalidate() { index_.reset(); }
+
+    template<class Container>
+    bool contains(const Container& c, const T& x) const
+    {
+        if constexpr (!is_hashable_v<T> && !is_less_than_comparable_v<T>) {
+            return std::find(std::begin(c), std::end(c), x) != std::end(c); // nothing to index by
+        } else {
+            if (!index_)
+                index_ = std::make_unique<state>(state{build(c)});
+
+            if constexpr (is_hashable_v<T>)
+                return index_->elements.find(x) != index_->elements.end();
+            else
+                return std::binary_search(index_->elements.begin(), index_->elements.end(), x);
+        }
+    }
+
+private:
+    // Only looked into on use, so that containers of incomplete types still compile
+    struct state {
+        using elements_type = std::conditional_t<is_hashable_v<T>, std::unordered_set<T>, std::vector<T>>;
+
+        elements_type elements;
+    };
+
+    template<class Container>
+    static auto build(const Container& c)
+    {
+        typename state::elements_type elements(std::begin(c), std::end(c));
+        if constexpr (!is_hashable_v<T>)
+            std::sort(elements.begin(), elements.end());
+        return elements;
+    }
+
+    mutable std::unique_ptr<state> index_;
+};
+
+// Up to this many bytes of arithmetic elements a vectorized scan beats hashing
+constexpr size_t scan_beats_index_bytes = 1024;
+
+} // namespace internal
+
+template<class Container>
+class indexed : private zen::stackonly
+{
+public:
+    using container_type  = Container;
+    using value_type      = typename Container::value_type;
+    using allocator_type  = typename Container::allocator_type;
+    using size_type       = typename Container::size_type;
+    using difference_type = typename Container::difference_type;
+    using const_reference = typename Container::const_reference;
+    using const_iterator  = typename Container::const_iterator;
+    using iterator        = const_iterator; // writes go through the members below
+
+    indexed() = default;
+    explicit indexed(Container c) : c_(std::move(c)) {}
+    indexed(std::initializer_list<value_type> init, const allocator_type& alloc = allocator_type()) : c_(init, alloc) {}
+
+    template<class InputIt>
+    indexed(InputIt first, InputIt last, const allocator_type& alloc = allocator_type()) : c_(first, last, alloc) {}
+
+    // ----- reading
+
+    const Container& container() const { return c_; }
+
+    const_iterator begin()  const { return c_.begin(); }
+    const_iterator end()    const { return c_.end();   }
+    const_iterator cbegin() const { return c_.begin(); }
+    const_iterator cend()   const { return c_.end();   }
+
+    const_reference operator[](size_type i) const { return c_[i];       }
+    const_reference at(size_type i)         const { return c_.at(i);    }
+    const_reference front()                 const { return c_.front();  }
+    const_reference back()                  const { return c_.back();   }
+
+    size_type size()     const { return c_.size();  }
+    bool      empty()    const { return c_.empty(); }
+    bool      is_empty() const { return c_.empty(); }
+
+    allocator_type get_allocator() const { return c_.get_allocator(); }
+
+    // Small vectors of arithmetic elements are scanned, which beats hashing them
+    bool contains(const value_type& x) const
+    {
+        if constexpr (internal::simd::is_countable_v<value_type> && requires(const Container& c) { c.data(); }) {
+            if (c_.size() * sizeof(value_type) <= internal::scan_beats_index_bytes)
+                return c_.contains(x);
+        }
+        return index_.contains(c_, x);
+    }
+
+    template<class Pred>
+    typename std::enable_if<std::is_invocable_r<bool, Pred, const value_type&>::value, bool>::type
+        contains(Pred p) const
+    {
+        return c_.contains(p);
+    }
+
+    template<class ExecutionPolicy, class X>
+    typename std::enable_if<execution::is_execution_policy_v<ExecutionPolicy>, bool>::type
+        contains(ExecutionPolicy&& policy, const X& x) const
+    {
+        return c_.contains(std::forward<ExecutionPolicy>(policy), x);
+    }
+
+    // ----- changing, which leaves the index to be rebuilt by the next contains(x)
+
+    void set(size_type i, const value_type& x) { changed(); c_.at(i) = x; }
+    void set(size_type i, value_type&& x)      { changed(); c_.at(i) = std::move(x); }
+
+    // Hands f the container, for changes the members below don't cover
+    // Example: v.modify([](auto& c) { std::sort(c.begin(), c.end()); });
+    template<class F>
+    decltype(auto) modify(F&& f)
+    {
+        changed();
+        return std::forward<F>(f)(c_);
+    }
+
+    void push_back(const value_type& x) { changed(); c_.push_back(x); }
+    void push_back(value_type&& x)      { changed(); c_.push_back(std::move(x)); }
+
+    template<class... Args>
+    const_reference emplace_back(Args&&... args) { changed(); return c_.emplace_back(std::forward<Args>(args)...); }
+
+    void pop_back() { changed(); c_.pop_back(); }
+
+    // Where the container has them, as zen::deque does
+    void push_front(const value_type& x) requires requires(Container& c) { c.pop_front(); } { changed(); c_.push_front(x); }
+    void push_front(value_type&& x)      requires requires(Container& c) { c.pop_front(); } { changed(); c_.push_front(std::move(x)); }
+    void pop_front()                     requires requires(Container& c) { c.pop_front(); } { changed(); c_.pop_front(); }
+
+    template<class... Args>
+    const_iterator emplace(const_iterator pos, Args&&... args) { changed(); return c_.emplace(pos, std::forward<Args>(args)...); }
+
+    const_iterator insert(const_iterator pos, const value_type& x) { changed(); return c_.insert(pos, x); }
+    const_iterator insert(const_iterator pos, value_type&& x)      { changed(); return c_.insert(pos, std::move(x)); }
+    const_iterator insert(const_iterator pos, std::initializer_list<value_type> init) { changed(); return c_.insert(pos, init); }
+
+    template<class InputIt>
+    const_iterator insert(const_iterator pos, InputIt first, InputIt last) { changed(); return c_.insert(pos, first, last); }
+
+    const_iterator erase(const_iterator pos)                        { changed(); return c_.erase(pos); }
+    const_iterator erase(const_iterator first, const_iterator last) { changed(); return c_.erase(first, last); }
+
+    void clear()                                     { changed(); c_.clear(); }
+    void resize(size_type n)                         { changed(); c_.resize(n); }
+    void resize(size_type n, const value_type& x)    { changed(); c_.resize(n, x); }
+    void assign(size_type n, const value_type& x)    { changed(); c_.assign(n, x); }
+    void assign(std::initializer_list<value_type> init) { changed(); c_.assign(init); }
+
+    template<class InputIt>
+    void assign(InputIt first, InputIt last) { changed(); c_.assign(first, last); }
+
+    // Doesn't change the elements, so the index stays
+    void reserve(size_type n) requires requires(Container& c) { c.reserve(n); } { c_.reserve(n); }
+
+    void swap(indexed& x) noexcept
+    {
+        changed();
+        x.changed();
+        c_.swap(x.c_);
+    }
+
+    friend bool operator==(const indexed& a, const indexed& b) { return a.c_ == b.c_; }
+
+private:
+    void changed() { index_.invalidate(); }
+
+    Container                              c_;
+    internal::membership_index<value_type> index_;
+};
+
+template<class T, class A = std::allocator<T>>
+using indexed_vector = indexed<zen::vector<T, A>>;
+
+template<class T, class A = std::allocator<T>>
+using indexed_deque  = indexed<zen::deque<T, A>>;
+
+// One Linux system gave the warning: In the GNU C Library, "major" is defined
+// by <sys/sysmacros.h>. For historical compatibility, it is currently defined
+// by <sys / types.h> as well, but we plan to remove this soon. To use "major",
+// include < sys / sysmacros directly. If you did not intend to use a system-defined
+// macro "major", you should undefine it after including <sys/types.h>.
+// So we undefine them:
+#undef major
+#undef minor
+
+///////////////////////////////////////////////////////////////////////////////////////////// zen::version
+// Example: zen::version v8("8.2.3.4567");
+// Example: zen::version v1(1, 2, 3, 4567);
+// v1.major() == 1;
+// v1.minor() == 2;
+// v1.patch() == 3;
+// v1.build() == 4567;
+// Components are ints, so build numbers well past 65535 are fine. Two versions are
+// compared as two 64-bit words, each packing two components, rather than component
+// by component.
+class version : public std::array<int, 4> { 
+public:
+    constexpr version(int major, int minor, int patch, int build)
+        : std::array<int, 4>{major, minor, patch, build}
+    {}
+
+    // Parsed without std::regex or std::stoi: digits are read with std::from_chars at
+    // run time and with a plain loop in constant evaluation, where from_chars isn't
+    // available before C++23. A malformed string fails to compile in the latter case.
+    constexpr explicit version(const std::string_view text)
+        : std::array<int, 4>{}
+    {
+        if (!parse_into(text, *this))
+            bad_pattern();
+    }
+
+    // Same, without the exception, for parsing many versions of unknown quality
+    // Example: if (auto v = zen::version::parse(manifest_field)) { ... }
+    static constexpr std::optional<version> parse(const std::string_view text) noexcept
+    {
+        version v;
+        if (!parse_into(text, v))
+            return std::nullopt;
+        return v;
+    }
+
+    constexpr auto major() const { return (*this)[0]; }
+    constexpr auto minor() const { return (*this)[1]; }
+    constexpr auto patch() const { return (*this)[2]; }
+    constexpr auto build() const { return (*this)[3]; }
+
+    friend constexpr bool operator==(const version& a, const version& b) { return a.packed() ==  b.packed(); }
+    friend constexpr auto operator<=>(const version& a, const version& b) { return a.packed() <=> b.packed(); }
+
+private:
+    // Major and minor in the first word, patch and build in the second, each ordered
+    // like the versions. Flipping the sign bit orders negative components (which
+    // only the int constructor can make) before the others, as ints are.
+    constexpr std::pair<uint64_t, uint64_t> packed() const
+    {
+        constexpr auto bits = [](int c) { return static_cast<uint64_t>(static_cast<uint32_t>(c) ^ 0x8000'0000u); };
+        return { bits(major()) << 32 | bits(minor()), bits(patch()) << 32 | bits(build()) };
+    }
+
+    constexpr version() : std::array<int, 4>{} {}
+
+    static constexpr bool parse_into(const std::string_view text, version& v) noexcept
+    {
+        const char*       p   = text.data();
+        const char* const end = text.data() + text.size();
+        for (size_t i = 0; i < 4; ++i) {
+            if (i > 0 && (p == end || *p++ != '.'))
+                return false;
+            if (!parse_component(p, end, v[i]))
+                return false;
+        }
+        return p == end;
+    }
+
+    // One or more digits with a value that fits in an int. Leading zeros are accepted
+    // and don't count towards the limit, so "000001" reads as 1 in both paths.
+    static constexpr bool parse_component(const char*& p, const char* const end, int& value) noexcept
+    {
+        if (std::is_constant_evaluated()) {
+            const char* const first = p;
+            value = 0;
+            for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+                if (value > (std::numeric_limits<int>::max() - (*p - '0')) / 10)
+                    return false;
+                value = value * 10 + (*p - '0');
+            }
+            return p != first;
+        }
+        if (p == end || *p < '0' || *p > '9') // from_chars would also accept a minus sign
+            return false;
+        const auto [next, error] = std::from_chars(p, end, value);
+        p = next;
+        return error == std::errc();
+    }
+
+    [[noreturn]] static void bad_pattern()
+    {
+        throw std::invalid_argument{
+            // Any cost of typeid is likely to be dwarfed by the cost of the exception anyway
+            std::string(typeid(version).name()) + " CONSTRUCTOR ARGUMENT STRING DOESN'T MATCH THE EXPECTED M.M.P.B PATTERN."
+        };
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const version& v)
+{
+    return os << v.major() << '.' << v.minor() << '.' << v.patch() << '.' << v.build();
+}
+
+namespace literals::version {
+
+// Checked at compile time: a malformed version doesn't compile
+// Example: auto v7 = "7.6.5.4321"_version;
+consteval zen::version operator""_version(const char* text, size_t length)
+{
+    const auto v = zen::version::parse(std::string_view(text, length));
+    if (!v)
+        throw std::invalid_argument("_version LITERAL DOESN'T MATCH THE EXPECTED M.M.P.B PATTERN");
+    return *v;
+}
+
+} // namespace literals::version
+
+///////////////////////////////////////////////////////////////////////////////////////////// USEFUL MISC
+
+// Repeats a string patterns.
+// This is the symmetrical complement of repeat(int, str).
+// Example: repeat("*", 10);
+// Result:  "**********"
+zen::string repeat(const std::string_view s, const int n) {
+    zen::string result;
+    if (n > 0 && !s.empty()) {
+        result.resize(s.size() * static_cast<size_t>(n)); // the only allocation
+        internal::fill_pattern(result.data(), result.size(), s);
+    }
+    return result;
+}
+
+// This is the symmetrical complement of repeat(str, int).
+// Repeats a string patterns.
+// Example: repeat(10, "*");
+// Result:  "**********"
+zen::string repeat(const int n, const std::string_view s) {
+    return repeat(s, n);
+}
+
+// Which side of the text padding goes to in pad_column()
+enum class justify { left, right };
+
+// Pads every string of a table column to a common width in one pass. With the
+// default width of 0 the column is padded to the length of its widest entry.
+// Example: zen::strings names = {"id", "name", "timestamp"};
+//          zen::pad_column(names);
+// Result:  {"id       ", "name     ", "timestamp"}
+// Example: zen::pad_column(values, 12, zen::justify::right);
+template<class Iterable>
+void pad_column(Iterable& column, size_t width = 0, justify side = justify::left, const std::string_view pad_string = " ")
+{
+    ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+
+    if (width == 0)
+        for (const auto& cell : column)
+            width = std::max(width, cell.size());
+
+    for (auto& cell : column) {
+        if (side == justify::left)
+            internal::pad_end(  cell, width, pad_string);
+        else
+            internal::pad_start(cell, width, pad_string);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// RANDOM
+//
+// Fast random number engines and the thread-local generator behind random_int()
+// and fill_random(). Both engines satisfy UniformRandomBitGenerator, so they also
+// work with the std distributions and algorithms like std::shuffle.
+
+// splitmix64, used to expand a single 64-bit seed into engine state
+inline uint64_t splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** by Blackman and Vigna: 64-bit output, 256 bits of state,
+// several times faster than std::mt19937_64 and with a smaller footprint
+class xoshiro256ss {
+public:
+    using result_type = uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    explicit xoshiro256ss(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed)
+    {
+        for (auto& s : s_)
+            s = splitmix64(seed);
+    }
+
+    result_type operator()()
+    {
+        const uint64_t result = std::rotl(s_[1] * 5, 7) * 9;
+        const uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = std::rotl(s_[3], 45);
+        return result;
+    }
+
+    // Advances the state by 2^128 steps, which splits one seed into
+    // 2^128 non-overlapping sequences, one per thread for example
+    void jump()
+    {
+        constexpr uint64_t polynomial[] = { 0x180EC6D33CFD0ABA, 0xD5A61266F0C9392C, 0xA9582618E03FC9AA, 0x39ABDC4529B1661C };
+        uint64_t s[4] = {};
+        for (uint64_t p : polynomial) {
+            for (int bit = 0; bit < 64; ++bit) {
+                if (p & (uint64_t(1) << bit))
+                    for (int i = 0; i < 4; ++i) s[i] ^= s_[i];
+                (*this)();
+            }
+        }
+        std::copy(std::begin(s), std::end(s), std::begin(s_));
+    }
+
+    friend bool operator==(const xoshiro256ss& a, const xoshiro256ss& b) { return std::equal(a.s_, a.s_ + 4, b.s_); }
+
+private:
+    uint64_t s_[4];
+};
+
+// PCG32 (XSH RR) by O'Neill: 32-bit output from 64 bits of state, with
+// 2^63 selectable streams that give independent sequences for one seed
+class pcg32 {
+public:
+    using result_type = uint32_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint32_t>::max(); }
+
+    explicit pcg32(uint64_t seed = 0, uint64_t stream = 0) { this->seed(seed, stream); }
+
+    void seed(uint64_t seed, uint64_t stream = 0)
+    {
+        state_ = 0;
+        inc_   = (stream << 1) | 1;
+        (*this)();
+        state_ += seed;
+        (*this)();
+    }
+
+    result_type operator()()
+    {
+        const uint64_t old = state_;
+        state_ = old * 6364136223846793005ull + inc_;
+        const auto xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        return std::rotr(xorshifted, static_cast<int>(old >> 59));
+    }
+
+    friend bool operator==(const pcg32& a, const pcg32& b) { return a.state_ == b.state_ && a.inc_ == b.inc_; }
+
+private:
+    uint64_t state_;
+    uint64_t inc_;
+};
+
+namespace internal {
+    // Seeds of the thread-local engines: from std::random_device until seed_random() is called
+    inline std::atomic<bool>&     random_seeded() { static std::atomic<bool>     x{false}; return x; }
+    inline std::atomic<uint64_t>& random_seed()   { static std::atomic<uint64_t> x{0};     return x; }
+    inline std::atomic<uint64_t>& random_stream() { static std::atomic<uint64_t> x{0};     return x; }
+
+    // Stream k is seeded with the seed xored with a hash of k. Adding k times the
+    // splitmix64 increment instead would make the state of stream k+1 that of
+    // stream k shifted by one word, as the engine expands its seed with splitmix64.
+    inline uint64_t next_thread_seed()
+    {
+        if (random_seeded().load()) {
+            uint64_t stream = random_stream().fetch_add(1);
+            return random_seed().load() ^ splitmix64(stream);
+        }
+        std::random_device rd;
+        return (uint64_t(rd()) << 32) ^ rd();
+    }
+
+    // 64 random bits from any engine with a 32- or 64-bit output
+    template<class Engine>
+    uint64_t random_bits(Engine& e)
+    {
+        static_assert(Engine::min() == 0, "ENGINE EXPECTED TO OUTPUT FULL 32- OR 64-BIT WORDS");
+        if constexpr (Engine::max() == std::numeric_limits<uint64_t>::max())
+            return e();
+        else if constexpr (Engine::max() == std::numeric_limits<uint32_t>::max())
+            return (uint64_t(e()) << 32) | e();
+        else
+            static_assert(Engine::max() == 0, "ENGINE EXPECTED TO OUTPUT FULL 32- OR 64-BIT WORDS");
+    }
+
+    // Uniform in [0, range] from the 64 random bits 'bits' without modulo bias: Lemire's
+    // multiply-and-reject, which needs a division only in the rare case that a draw has to
+    // be rejected. The few draws that are rejected are replaced by ones from 'e'.
+    template<class Engine>
+    uint64_t random_below_or_at(uint64_t bits, uint64_t range, Engine& e)
+    {
+        if (range == std::numeric_limits<uint64_t>::max())
+            return bits;
+        const uint64_t n = range + 1;
+        if (n <= std::numeric_limits<uint32_t>::max()) {
+            uint64_t m = (bits >> 32) * n;
+            if (static_cast<uint32_t>(m) < n) {
+                const uint32_t threshold = static_cast<uint32_t>(-static_cast<uint32_t>(n)) % static_cast<uint32_t>(n);
+                while (static_cast<uint32_t>(m) < threshold)
+                    m = (random_bits(e) >> 32) * n;
+            }
+            return m >> 32;
+        }
+        // Wider ranges are rare enough for a plain masked rejection
+        const uint64_t mask = std::bit_ceil(n) - 1;
+        for (uint64_t x = bits & mask; ; x = random_bits(e) & mask)
+            if (x < n)
+                return x;
+    }
+
+    template<class T, class Engine>
+    T random_integer(uint64_t bits, T min, T max, Engine& e)
+    {
+        using U = std::make_unsigned_t<T>;
+        const uint64_t range = static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+        return static_cast<T>(static_cast<U>(min) + static_cast<U>(random_below_or_at(bits, range, e)));
+    }
+
+    template<class T, class Engine>
+    T random_integer(Engine& e, T min, T max)
+    {
+        return random_integer(random_bits(e), min, max, e);
+    }
+
+    // Uniform in [min, max), from the top 53 (or 24) bits, every value equally spaced
+    template<class T>
+    T random_real(uint64_t bits, T min, T max)
+    {
+        if constexpr (sizeof(T) <= 4) {
+            const T u = static_cast<T>(bits >> 40) * T(0x1.0p-24);
+            return min + u * (max - min);
+        } else {
+            const T u = static_cast<T>(bits >> 11) * T(0x1.0p-53);
+            return min + u * (max - min);
+        }
+    }
+
+    template<class T, class Engine>
+    T random_real(Engine& e, T min, T max)
+    {
+        return random_real(random_bits(e), min, max);
+    }
+
+    // The generation of the seed: seed_random() bumps it, which tells the
+    // bulk generators of every thread to reseed from their thread's engine
+    inline std::atomic<uint64_t>& random_epoch() { static std::atomic<uint64_t> x{0}; return x; }
+} // namespace internal
+
+// The engine of the calling thread, created and seeded on first use. Since every
+// thread has its own, nothing is shared between threads and nothing needs locking.
+inline xoshiro256ss& random_engine()
+{
+    thread_local xoshiro256ss engine(internal::next_thread_seed());
+    return engine;
+}
+
+// Makes the random numbers of this program reproducible. Reseeds the calling
+// thread's engine with 'seed', and every thread that draws its first number
+// afterwards with a seed derived from it, in the order in which they do.
+// Example: zen::seed_random(42);
+inline void seed_random(uint64_t seed)
+{
+    xoshiro256ss& engine = random_engine(); // created first, or it would take stream 1 on the first call
+    internal::random_seed()   = seed;
+    internal::random_stream() = 1;
+    internal::random_seeded() = true;
+    ++internal::random_epoch();
+    engine.seed(seed);
+}
+
+// ------------------------------------------------------------------------------------------ bulk
+
+namespace internal {
+
+// Four xoshiro256** engines side by side, one state word of all four per 256-bit
+// register, so that AVX2 steps them at once. The vectorized and the scalar step
+// produce the same words, so a seed reproduces the same numbers on every CPU.
+struct xoshiro256ss_x4 {
+    alignas(32) uint64_t s[4][4]; // [state word][engine]
+    uint64_t epoch = 0;
+
+    explicit xoshiro256ss_x4(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed)
+    {
+        for (auto& word : s)
+            for (auto& x : word)
+                x = splitmix64(seed);
+    }
+};
+
+namespace simd {
+
+#if ZEN_SIMD_X86
+
+ZEN_TARGET("avx2")
+inline __m256i rotl_avx2(__m256i x, int k)
+{
+    return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+// AVX2 has no 64-bit multiply, but the two of xoshiro256** are by 5 and 9,
+// which are a shift and an add each
+ZEN_TARGET("avx2")
+inline void random_words_avx2(xoshiro256ss_x4& g, uint64_t* out, size_t n)
+{
+    __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(g.s[0]));
+    __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(g.s[1]));
+    __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(g.s[2]));
+    __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(g.s[3]));
+    for (size_t i = 0; i + 4 <= n; i += 4) {
+        const __m256i x5 = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+        const __m256i r  = rotl_avx2(x5, 7);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(_mm256_slli_epi64(r, 3), r));
+        const __m256i t = _mm256_slli_epi64(s1, 17);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = rotl_avx2(s3, 45);
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(g.s[0]), s0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(g.s[1]), s1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(g.s[2]), s2);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(g.s[3]), s3);
+}
+
+// The mapping of random words to numbers, the same as random_real() and random_integer()
+// but four at a time. Doubles are converted from the top 53 bits in two exact halves,
+// as AVX2 has no 64-bit integer conversion. 32-bit integers take the multiply of
+// Lemire's method on all four, and leave the rare draws that need the rejection step
+// (at most one in 2^32 / n) to the scalar code, which returns how many it handled.
+ZEN_TARGET("avx2")
+inline void map_real_avx2(const uint64_t* words, double* out, size_t n, double min, double max)
+{
+    const __m256i lo_mask  = _mm256_set1_epi64x(0xFFFFFFFF);
+    const __m256i lo_exp   = _mm256_set1_epi64x(0x4330000000000000); // 2^52
+    const __m256i hi_exp   = _mm256_set1_epi64x(0x4530000000000000); // 2^84
+    const __m256d magic    = _mm256_set1_pd(0x1.0p84 + 0x1.0p52);
+    const __m256d scale    = _mm256_set1_pd(0x1.0p-53);
+    const __m256d base     = _mm256_set1_pd(min);
+    const __m256d width    = _mm256_set1_pd(max - min);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i v  = _mm256_srli_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i)), 11);
+        const __m256d lo = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(v, lo_mask), lo_exp));
+        const __m256d hi = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(v, 32), hi_exp));
+        const __m256d u  = _mm256_mul_pd(_mm256_add_pd(_mm256_sub_pd(hi, magic), lo), scale);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(base, _mm256_mul_pd(u, width)));
+    }
+    for (; i < n; ++i)
+        out[i] = random_real(words[i], min, max);
+}
+
+template<class T, class Engine>
+ZEN_TARGET("avx2")
+inline void map_integer_avx2(const uint64_t* words, T* out, size_t n, T min, T max, Engine& fallback)
+{
+    static_assert(sizeof(T) == 4);
+    const uint64_t range = static_cast<uint32_t>(static_cast<uint32_t>(max) - static_cast<uint32_t>(min));
+    if (range == std::numeric_limits<uint32_t>::max()) {
+        for (size_t i = 0; i < n; ++i) out[i] = random_integer(words[i], min, max, fallback);
+        return;
+    }
+    const __m256i count   = _mm256_set1_epi64x(static_cast<long long>(range + 1));
+    const __m256i lo_mask = _mm256_set1_epi64x(0xFFFFFFFF);
+    const __m256i base    = _mm256_set1_epi32(static_cast<int>(min));
+    const __m256i pack    = _mm256_setr_epi32(1, 3, 5, 7, 0, 2, 4, 6); // odd halves hold m >> 32
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i m = _mm256_mul_epu32(_mm256_srli_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i)), 32), count);
+        const __m256i r = _mm256_add_epi32(_mm256_permutevar8x32_epi32(m, pack), base);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(r));
+        if (!_mm256_testz_si256(_mm256_cmpgt_epi64(count, _mm256_and_si256(m, lo_mask)), _mm256_set1_epi64x(-1)))
+            for (size_t j = i; j < i + 4; ++j)
+                out[j] = random_integer(words[j], min, max, fallback);
+    }
+    for (; i < n; ++i)
+        out[i] = random_integer(words[i], min, max, fallback);
+}
+
+#endif // ZEN_SIMD_X86
+
+inline void random_words_scalar(xoshiro256ss_x4& g, uint64_t* out, size_t n)
+{
+    auto& [s0, s1, s2, s3] = g.s;
+    for (size_t i = 0; i + 4 <= n; i += 4) {
+        for (int j = 0; j < 4; ++j) {
+            out[i + j] = std::rotl(s1[j] * 5, 7) * 9;
+            const uint64_t t = s1[j] << 17;
+            s2[j] ^= s0[j];
+            s3[j] ^= s1[j];
+            s1[j] ^= s2[j];
+            s0[j] ^= s3[j];
+            s2[j] ^= t;
+            s3[j] = std::rotl(s3[j], 45);
+        }
+    }
+}
+
+// Fills out[0, n) with random words, n rounded down to a multiple of 4
+inline void random_words(xoshiro256ss_x4& g, uint64_t* out, size_t n)
+{
+#if ZEN_SIMD_X86
+    if (cpu().avx2)
+        return random_words_avx2(g, out, n);
+#endif
+    random_words_scalar(g, out, n);
+}
+
+} // namespace simd
+
+// Fills 'out' from the bulk generator g, a buffer of words at a time; draws
+// rejected by the integer mapping are replaced from the thread's engine
+template<class T>
+void fill_random(std::span<T> out, T min, T max, xoshiro256ss_x4& g, xoshiro256ss& fallback)
+{
+    constexpr size_t buffer_size = 256;
+    alignas(32) uint64_t words[buffer_size];
+    for (size_t i = 0; i < out.size(); i += buffer_size) {
+        const size_t k = std::min(buffer_size, out.size() - i);
+        simd::random_words(g, words, (k + 3) & ~size_t(3));
+#if ZEN_SIMD_X86
+        if constexpr (std::is_same_v<T, double>) {
+            if (simd::cpu().avx2) { simd::map_real_avx2(words, out.data() + i, k, min, max); continue; }
+        } else if constexpr (std::is_integral_v<T> && sizeof(T) == 4) {
+            if (simd::cpu().avx2) { simd::map_integer_avx2(words, out.data() + i, k, min, max, fallback); continue; }
+        }
+#endif
+        if constexpr (std::is_floating_point_v<T>)
+            for (size_t j = 0; j < k; ++j) out[i + j] = random_real(words[j], min, max);
+        else
+            for (size_t j = 0; j < k; ++j) out[i + j] = random_integer(words[j], min, max, fallback);
+    }
+}
+
+// The bulk generator of the calling thread, seeded from the thread's engine
+inline xoshiro256ss_x4& random_lanes()
+{
+    thread_local xoshiro256ss_x4 g(random_engine()());
+    if (const uint64_t epoch = random_epoch().load(std::memory_order_relaxed); g.epoch != epoch) {
+        g.seed(random_engine()());
+        g.epoch = epoch;
+    }
+    return g;
+}
+
+} // namespace internal
+
+// Fills a contiguous range with random numbers: integers in [min, max], reals
+// in [min, max). Much faster than calling random_int() per element: the thread's
+// bulk generator produces the random bits four at a time (with AVX2 if the CPU
+// has it), and the range arithmetic is set up once. The overload taking an engine
+// draws from it one number at a time, exactly as random_int() with it would.
+// Example: std::vector<double> v(1'000'000);
+//          zen::fill_random(std::span(v), -1.0, 1.0);
+template<class T, class Engine>
+void fill_random(std::span<T> out, T min, T max, Engine& engine)
+{
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "fill_random() EXPECTS INTEGERS OR REALS");
+    if constexpr (std::is_floating_point_v<T>)
+        for (T& x : out) x = internal::random_real(engine, min, max);
+    else
+        for (T& x : out) x = internal::random_integer(engine, min, max);
+}
+
+template<class T>
+void fill_random(std::span<T> out, T min, T max)
+{
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "fill_random() EXPECTS INTEGERS OR REALS");
+    internal::fill_random(out, min, max, internal::random_lanes(), random_engine());
+}
+
+
+// ------------------------------------------------------------------------------------------ distributions
+
+// Distributions in the style of the std ones (which work wherever these do): called
+// with an engine, they return the next random value. Containers of arithmetic types
+// filled with a uniform_distribution take the bulk path of fill_random().
+// Example: zen::uniform_distribution<double> d{0.0, 1.0};
+//          double x = d(zen::random_engine());
+template<class T>
+struct uniform_distribution {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "uniform_distribution EXPECTS INTEGERS OR REALS");
+    using result_type = T;
+
+    T min; // integers in [min, max], reals in [min, max)
+    T max;
+
+    template<class Engine>
+    T operator()(Engine& engine) const
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return internal::random_real(engine, min, max);
+        else
+            return internal::random_integer(engine, min, max);
+    }
+};
+
+// Strings of random length in [min_length, max_length], drawn from 'alphabet'
+// Example: zen::string_distribution d{3, 8, "ACGT"};
+//          std::string dna = d(zen::random_engine());
+struct string_distribution {
+    using result_type = std::string;
+
+    size_t           min_length = 5;
+    size_t           max_length = 10;
+    std::string_view alphabet   = "abcdefghijklmnopqrstuvwxyz";
+
+    template<class Engine>
+    std::string operator()(Engine& engine) const
+    {
+        if (alphabet.empty())
+            throw std::invalid_argument("STRING DISTRIBUTION WITH AN EMPTY ALPHABET");
+        std::string s(internal::random_integer(engine, min_length, max_length), '\0');
+        for (char& c : s)
+            c = alphabet[internal::random_integer(engine, size_t(0), alphabet.size() - 1)];
+        return s;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// MAIN UTILITIES
+
+// Example: random_int();
+// Result: A random integer between [min, max]
+template<class T = int>
+T random_int(const T min = 0, const T max = 10) {
+    // Reasons why the engine below is 'thread_local' (see random_engine() in RANDOM):
+    // ---------------------------------------------------------------------------------------------------------------
+    // 1. Initialization Efficiency:
+    // Random devices and generators often involve some computational cost due to entropy gathering, seeding, generator
+    // initialization and good old algorithmic complexity. A thread_local engine is initialized only once per thread,
+    // the first time the thread calls this function. Subsequent calls reuse the existing instance, avoiding the overhead.
+    // ---------------------------------------------------------------------------------------------------------------
+    // 2. State Preservation:
+    // Random number generators maintain an internal state that evolves as numbers are generated. This state determines
+    // the sequence of random numbers produced. As the engine outlives the call, its state is preserved across calls,
+    // ensuring a proper random sequence. Reinitializing it on every call might lead to repeated or patterned sequences.
+    // ---------------------------------------------------------------------------------------------------------------
+    // 3. Thread Safety:
+    // A 'static' engine would be shared by all threads calling this function, and calling it from several threads
+    // at once would be a data race on the engine's state. With one engine per thread, there's nothing to share and
+    // nothing to lock, so this function is safe (and just as fast) to call from any number of threads.
+    // ---------------------------------------------------------------------------------------------------------------
+    // 4. Resource Management
+    // The engine is destroyed when its thread ends, and it's a mere 32 bytes of state (xoshiro256**), compared to the
+    // 2.5 KB of the std::mt19937 used here before.
+    // ---------------------------------------------------------------------------------------------------------------
+    // 5. Avoiding Repetition
+    // If the generator was reseeded with the same or similar seeds (which might happen if the function is called
+    // in quick succession), you might get the same or similar random numbers in different calls. Every thread's engine
+    // is seeded once, from std::random_device, or deterministically when zen::seed_random() asks for reproducibility.
+    // ---------------------------------------------------------------------------------------------------------------
+    // The integer is drawn with Lemire's multiply-and-reject method rather than a std::uniform_int_distribution
+    // constructed per call, which saves the division of the latter in all but the rarest of cases.
+    ZEN_STATIC_ASSERT((std::is_integral_v<T> && !std::is_same_v<T, bool>), "TEMPLATE PARAMETER EXPECTED TO BE AN INTEGER, BUT IS NOT");
+    return internal::random_integer(random_engine(), min, max);
+}
+
+// Same, drawing from the given engine, like a seeded zen::xoshiro256ss or zen::pcg32
+// Example: zen::pcg32 engine(42);
+//          zen::random_int(1, 6, engine);
+template<class T, class Engine>
+T random_int(const T min, const T max, Engine& engine) {
+    ZEN_STATIC_ASSERT((std::is_integral_v<T> && !std::is_same_v<T, bool>), "TEMPLATE PARAMETER EXPECTED TO BE AN INTEGER, BUT IS NOT");
+    return internal::random_integer(engine, min, max);
+}
+
+namespace internal {
+    // What generate_random() fills a container of T with by default: numbers between 10
+    // and 99 (the integers inclusive), or strings of 5 to 10 lowercase letters. Other
+    // types get the integers, converted on assignment, as they always have.
+    template<class T>
+    auto default_distribution()
+    {
+        if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+            return uniform_distribution<T>{10, 99};
+        else if constexpr (!std::is_arithmetic_v<T> && std::is_constructible_v<T, std::string>)
+            return string_distribution{};
+        else
+            return uniform_distribution<int>{10, 99};
+    }
+
+    template<class Iterable, class T = std::remove_cvref_t<decltype(*std::begin(std::declval<Iterable&>()))>>
+    auto default_distribution_for() -> decltype(default_distribution<T>())
+    {
+        return default_distribution<T>();
+    }
+
+    template<class Iterable>
+    using default_distribution_t = decltype(default_distribution_for<Iterable>());
+
+    // Whether generate_random() can hand c over to fill_random()
+    template<class Iterable, class Distribution>
+    constexpr bool is_bulk_fillable()
+    {
+        if constexpr (is_contiguous_arithmetic_v<Iterable>) {
+            using T = std::remove_reference_t<decltype(*std::data(std::declval<Iterable&>()))>;
+            return !std::is_const_v<T> && std::is_same_v<Distribution, uniform_distribution<T>>;
+        } else
+            return false;
+    }
+
+    template<class Iterable>
+    void resize_if_empty(Iterable& c, int size)
+    {
+        if constexpr (zen::is_resizable_v<Iterable>)
+            if (std::empty(c))
+                c.resize(size);
+    }
+} // namespace internal
+
+// Very often all we want is a dead simple way of quickly
+// generating a container filled with some random numbers.
+// An empty container is resized to 'size' first (if it can be), then every
+// element is drawn from 'dist', by default the one that suits the element
+// type (see internal::default_distribution). Contiguous containers of numbers
+// with a uniform_distribution are filled in bulk, like fill_random() does.
+// Example: std::vector<int> v;
+//          zen::generate_random(v);
+// Result: A vector of size 10 with random integers between [10, 99]
+// Example: std::vector<double> v;
+//          zen::generate_random(v, 1000, std::normal_distribution<double>(0.0, 1.0));
+//          zen::generate_random(names, 100, zen::string_distribution{3, 8});
+template<class Iterable, class Distribution = internal::default_distribution_t<Iterable>>
+void generate_random(Iterable& c, int size = 10, Distribution dist = internal::default_distribution_for<Iterable>())
+{
+    ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+
+    internal::resize_if_empty(c, size);
+
+    if constexpr (internal::is_bulk_fillable<Iterable, Distribution>())
+        fill_random(std::span(std::data(c), std::size(c)), dist.min, dist.max);
+    else
+        std::generate(std::begin(c), std::end(c), [&]() { return dist(random_engine()); });
+}
+
+#if __cpp_concepts >= 202002L
+// Same, with the elements of large random-access containers generated by several
+// threads. Every block of the container gets its own engine, seeded from the calling
+// thread's engine and the index of the block's first element, so after
+// zen::seed_random() the result is the same on every run, whatever the thread count
+// and wherever the container keeps its elements. It isn't the sequence the
+// sequential generate_random() would produce, though.
+// Example: std::vector<double> v(10'000'000);
+//          zen::generate_random(zen::execution::par, v);
+template<class ExecutionPolicy, class Iterable, class Distribution = internal::default_distribution_t<Iterable>>
+    requires execution::is_execution_policy_v<ExecutionPolicy>
+void generate_random(ExecutionPolicy&& policy, Iterable& c, int size = 10, Distribution dist = internal::default_distribution_for<Iterable>())
+{
+    ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+
+    if constexpr (execution::is_parallel_policy_v<ExecutionPolicy> && internal::random_access_range<Iterable>) {
+        internal::resize_if_empty(c, size);
+        // Large containers are cut into blocks even for one thread, so that
+        // the numbers don't depend on the thread count
+        if (std::size(c) * sizeof(*std::begin(c)) >= internal::parallel_min_bytes) {
+            const auto     par  = internal::as_parallel(policy);
+            const uint64_t seed = random_engine()();
+            internal::parallel_blocks<char>(std::as_const(c), par.threads, [&](size_t begin, size_t end) -> char {
+                if constexpr (internal::is_bulk_fillable<Iterable, Distribution>()) {
+                    internal::xoshiro256ss_x4 lanes(seed + begin);
+                    xoshiro256ss fallback(~(seed + begin));
+                    internal::fill_random(std::span(std::data(c) + begin, end - begin), dist.min, dist.max, lanes, fallback);
+                } else {
+                    xoshiro256ss engine(seed + begin);
+                    Distribution block_dist = dist; // std distributions keep state between calls
+                    std::generate(std::begin(c) + begin, std::begin(c) + end, [&]() { return block_dist(engine); });
+                }
+                return 0;
+            });
+            return;
+        }
+    }
+    generate_random(c, size, dist);
+}
+#endif
+
+// Over the years it has become clear that the standard member
+// function empty() that lacks an 'is_' prefix is confusing to
+// non-familiar users due to its ambiguity as a noun and a verb.
+// Example: zen::is_empty(c); // c is any iterable container
+template<class HasEmpty>
+bool is_empty(const HasEmpty& c)
+{
+    ZEN_STATIC_ASSERT(zen::has_empty_v<HasEmpty>, "TEMPLATE PARAMETER EXPECTED TO HAVE empty(), BUT DOES NOT");
+    return c.empty();
+}
+
+// TODO: Think of a way to use the Addable concept in addition
+// to Iterable that will not make the resulting code too ugly.
+template<class Iterable>
+auto sum(const Iterable& c)
+{
+    ZEN_STATIC_ASSERT(is_iterable_v<Iterable>,         "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
+    ZEN_STATIC_ASSERT(is_addable_v<decltype(*std::begin(c))>, "ELEMENT TYPE EXPECTED TO BE Addable, BUT IS NOT");
+
+    if (c.empty()) {
+        return decltype(*std::begin(c)){}; // zero-initialized value for empty containers
+    }
+
+    // By initializing 'sum' to the first element of the collection and not just the tempting 0,
+    // this function makes fewer assumptions about the type it's working with, thereby making
+    // this function more robust and generic since we're dealing with arbitrary addable types
+    // (which could be complex numbers, matrices, etc.).
+    auto sum = *std::begin(c);
+    for (auto it = std::next(std::begin(c)); it != std::end(c); ++it) {
+        sum += *it;
+    }
+
+    return sum;
+}
+
+#if __cpp_concepts >= 202002L
+// Contiguous ranges of float, double and 32/64-bit integers are summed with AVX2 or
+// AVX-512 kernels (see the SIMD section). This overload is preferred over the generic
+// one above for exactly those types, every other type keeps using the generic one.
+// Example: std::vector<double> v(1'000'000, 0.5);
+//          zen::sum(v); // vectorized
+template<class Iterable>
+    requires ContiguousArithmetic<Iterable>
+          && internal::simd::is_summable_v<std::remove_cvref_t<decltype(*std::data(std::declval<const Iterable&>()))>>
+auto sum(const Iterable& c)
+{
+    return internal::simd::sum(std::data(c), std::size(c));
+}
+#endif
+
+// Comparison predicates for count_if() and the like. Unlike a lambda, they tell
+// zen::count_if() what they compare, so that over contiguous arithmetic ranges
+// it can use the vectorized kernels of the SIMD section. Anywhere else they
+// are ordinary predicates.
+// Example: zen::count_if(v, zen::is_greater_than(0.5));
+namespace internal {
+    template<simd::compare_op Op, class T>
+    struct comparison {
+        static constexpr simd::compare_op op = Op;
+        T value;
+
+        template<class U>
+        constexpr bool operator()(const U& x) const { return simd::compare<Op>(x, value); }
+    };
+} // namespace internal
+
+template<class T> constexpr auto is_equal_to(    const T& x) { return internal::comparison<internal::simd::compare_op::eq, std::decay_t<T>>{x}; }
+template<class T> constexpr auto is_not_equal_to(const T& x) { return internal::comparison<internal::simd::compare_op::ne, std::decay_t<T>>{x}; }
+template<class T> constexpr auto is_less_than(   const T& x) { return internal::comparison<internal::simd::compare_op::lt, std::decay_t<T>>{x}; }
+template<class T> constexpr auto is_at_most(     const T& x) { return internal::comparison<internal::simd::compare_op::le, std::decay_t<T>>{x}; }
+template<class T> constexpr auto is_greater_than(const T& x) { return internal::comparison<internal::simd::compare_op::gt, std::decay_t<T>>{x}; }
+template<class T> constexpr auto is_at_least(    const T& x) { return internal::comparison<internal::simd::compare_op::ge, std::decay_t<T>>{x}; }
+
+template<class Iterable, class EqualityComparable>
+auto count(const Iterable& c, const EqualityComparable& x)
+{
+    ZEN_STATIC_ASSERT(is_iterable_v<Iterable>,
+        "TEMPLATE PARAMETER Iterable EXPECTED TO BE ITERABLE, BUT IS NOT");
+    ZEN_STATIC_ASSERT(is_equality_comparable_v<EqualityComparable>,
+        "TEMPLATE PARAMETER EqualityComparable EXPECTED TO BE EqualityComparable, BUT IS NOT");
+
+    size_t count = 0;
+    for (auto it = std::begin(c); it != std::end(c); ++it) {
+        if (*it == x)
+            ++count;
+    }
+
+    return count;
+}
+
+template<class Iterable, class Pred>
+auto count_if(const Iterable& c, Pred p)
+{
+    using T = decltype(*std::begin(c));
+    ZEN_STATIC_ASSERT(is_iterable_v<Iterable>,
+        "TEMPLATE PARAMETER Iterable EXPECTED TO BE ITERABLE, BUT IS NOT");
+    ZEN_STATIC_ASSERT((std::is_invocable_r<bool, Pred, const T&>::value),
+        "TEMPLATE PARAMETER Predicate NOT APPLICABLE TO ELEMENT TYPE");
+
+    size_t count = 0;
+    for (auto it = std::begin(c); it != std::end(c); ++it) {
+        if (p(*it))
+            ++count;
+    }
+
+    return count;
+}
 
+#if __cpp_concepts >= 202002L
+namespace internal {
     template<class Iterable>
-    priority_queue(const Iterable& c)
+    using element_t = std::remove_cvref_t<decltype(*std::data(std::declval<const Iterable&>()))>;
+
+    // Comparing the elements of Iterable with an X has to happen in the element type
+    // itself, as it does in the vector compares: a double compared with an int is
+    // fine, an int compared with a double (where the int would be promoted) is not.
+    template<class Iterable, class X>
+    concept simd_countable = ContiguousArithmetic<Iterable>
+                          && std::is_arithmetic_v<X>
+                          && simd::is_countable_v<element_t<Iterable>>
+                          && std::is_same_v<std::common_type_t<element_t<Iterable>, X>, element_t<Iterable>>;
+
+    template<simd::compare_op Op, class Iterable, class X>
+    size_t parallel_count(execution::parallel_policy policy, const Iterable& c, const X& x)
     {
-        ZEN_STATIC_ASSERT(zen::is_iterable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
-
-        for (const auto& x : c)
-            my::push(x);
+        using T = element_t<Iterable>;
+        const T* p = std::data(c);
+        const size_t n = std::size(c);
+        if (!is_worth_parallel(c, policy))
+            return simd::count<Op>(p, n, static_cast<T>(x));
+
+        size_t count = 0;
+        for (size_t partial : parallel_blocks<size_t>(c, policy.threads,
+                [&](size_t begin, size_t end) { return simd::count<Op>(p + begin, end - begin, static_cast<T>(x)); }))
+            count += partial;
+        return count;
     }
 
-    bool is_empty() const { return my::empty(); }
+    // Counts the elements of a random-access range that satisfy p, block by block
+    template<class Iterable, class Pred>
+    size_t parallel_count_if(execution::parallel_policy policy, const Iterable& c, Pred p)
+    {
+        size_t count = 0;
+        for (size_t partial : parallel_blocks<size_t>(c, policy.threads, [&](size_t begin, size_t end) {
+                size_t n = 0;
+                for (auto it = std::begin(c) + begin; it != std::begin(c) + end; ++it)
+                    n += static_cast<bool>(p(*it));
+                return n;
+            }))
+            count += partial;
+        return count;
+    }
 
-private:
-    using my = priority_queue<T, C, L>;
-};
+    template<class Pred>
+    struct is_comparison : std::false_type {};
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::set
+    template<simd::compare_op Op, class T>
+    struct is_comparison<comparison<Op, T>> : std::true_type {};
+} // namespace internal
 
-template<class K, class C = std::less<K>, class A = std::allocator<K>>
-class set : public std::set<K, C, A>, private zen::stackonly
+// Contiguous ranges of arithmetic elements are counted with the vectorized
+// kernels of the SIMD section, and so are the comparison predicates above.
+// Example: std::vector<int> v = {1, 2, 3, 2, 1};
+//          zen::count(v, 2);                         // vectorized, 2
+//          zen::count_if(v, zen::is_greater_than(1)); // vectorized, 3
+template<class Iterable, class EqualityComparable>
+    requires internal::simd_countable<Iterable, EqualityComparable>
+auto count(const Iterable& c, const EqualityComparable& x)
 {
-public:
-    using std::set<K, C, A>::set; // inherit constructors, has to be explicit
-
-    set(const std::set<K, C, A>& u) : std::set<K, C, A>(u) {}
-
-    template<class Kx, class Cx, class Ax>
-    set(const std::set<Kx, Cx, Ax>& u) : std::set<K, C, A>(u.begin(), u.end()) {}
-
-    bool is_empty() const { return my::empty(); }
-
-private:
-    using my = set<K, C, A>;
-};
-
-///////////////////////////////////////////////////////////////////////////////////////////// zen::multiset
+    using T = internal::element_t<Iterable>;
+    return internal::simd::count<internal::simd::compare_op::eq>(std::data(c), std::size(c), static_cast<T>(x));
+}
 
-template<class K, class C = std::less<K>, class A = std::allocator<K>>
-class multiset : public std::multiset<K, C, A>, private zen::stackonly
+template<class Iterable, internal::simd::compare_op Op, class T>
+    requires internal::simd_countable<Iterable, T>
+auto count_if(const Iterable& c, internal::comparison<Op, T> p)
 {
-public:
-    using std::multiset<K, C, A>::multiset; // inherit constructors, has to be explicit
-
-    multiset(const std::multiset<K, C, A>& u) : std::multiset<K, C, A>(u) {}
-
-    template<class Kx, class Cx, class Ax>
-    multiset(const std::multiset<Kx, Cx, Ax>& u) : std::multiset<K, C, A>(u.begin(), u.end()) {}
-
-    bool is_empty() const { return my::empty(); }
-
-private:
-    using my = multiset<K, C, A>;
-};
+    using E = internal::element_t<Iterable>;
+    return internal::simd::count<Op>(std::data(c), std::size(c), static_cast<E>(p.value));
+}
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::stack
+// ------------------------------------------------------------------------------------------ parallel
+
+// The parallel overloads of sum(), count() and count_if() split large random-access
+// ranges into blocks of fixed element counts, hand the blocks out to threads, and
+// combine the per-block results in block order. Contiguous arithmetic ranges run the
+// vectorized kernels on every block, summing each in an order fixed by the element
+// indices. Since neither the blocks nor the order within them depend on the thread
+// count or on where the data sits in memory, floating-point sums of the same values
+// come out the same on every run (on the same kind of CPU), although they can differ
+// in the last bits from the sequential sum. Other ranges, ranges too small
+// to be worth the threads and the sequenced policy fall back to the sequential versions.
+// Example: zen::sum(zen::execution::par, v);
+//          zen::count(zen::execution::par(4), v, 42);
+//          zen::count_if(zen::execution::par, v, zen::is_greater_than(0.5));
+template<class ExecutionPolicy, class Iterable>
+    requires execution::is_execution_policy_v<ExecutionPolicy>
+auto sum(ExecutionPolicy&& policy, const Iterable& c)
+{
+    using T = std::remove_cvref_t<decltype(*std::begin(c))>;
+    if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+        const auto par = internal::as_parallel(policy);
+        if constexpr (ContiguousArithmetic<Iterable> && internal::simd::is_summable_v<T>) {
+            // The same blocks even when they aren't worth threads, so that the result
+            // depends neither on the thread count nor on the size threshold
+            const T* p = std::data(c);
+            T total{};
+            for (const T& partial : internal::parallel_blocks<T>(c, internal::is_worth_parallel(c, par) ? par.threads : 1,
+                    [&](size_t begin, size_t end) { return internal::simd::sum(p + begin, end - begin, false); }))
+                total += partial;
+            return total;
+        } else if constexpr (internal::random_access_range<Iterable> && std::is_default_constructible_v<T>) {
+            if (internal::is_worth_parallel(c, par)) {
+                // Like the generic sum(), every block starts from its first element rather than from 0
+                const auto partials = internal::parallel_blocks<T>(c, par.threads, [&](size_t begin, size_t end) {
+                    T block_sum = *(std::begin(c) + begin);
+                    for (auto it = std::begin(c) + begin + 1; it != std::begin(c) + end; ++it)
+                        block_sum += *it;
+                    return block_sum;
+                });
+                T total = partials.front();
+                for (size_t i = 1; i < partials.size(); ++i)
+                    total += partials[i];
+                return total;
+            }
+        }
+    }
+    return static_cast<T>(zen::sum(c));
+}
 
-template<class T, class C = std::deque<T>>
-class stack : public std::stack<T, C>, private zen::stackonly
+template<class ExecutionPolicy, class Iterable, class EqualityComparable>
+    requires execution::is_execution_policy_v<ExecutionPolicy>
+auto count(ExecutionPolicy&& policy, const Iterable& c, const EqualityComparable& x)
 {
-public:
-    using std::stack<T, C>::stack; // inherit constructors, has to be explicit
+    if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+        const auto par = internal::as_parallel(policy);
+        if constexpr (internal::simd_countable<Iterable, EqualityComparable>)
+            return internal::parallel_count<internal::simd::compare_op::eq>(par, c, x);
+        else if constexpr (internal::random_access_range<Iterable>) {
+            if (internal::is_worth_parallel(c, par))
+                return internal::parallel_count_if(par, c, [&](const auto& e) { return e == x; });
+        }
+    }
+    return zen::count(c, x);
+}
 
-    stack(const std::stack<T, C>& q) : std::stack<T, C>(q) {}
-        
-    bool is_empty() const { return my::empty(); }
+template<class ExecutionPolicy, class Iterable, class Pred>
+    requires execution::is_execution_policy_v<ExecutionPolicy>
+auto count_if(ExecutionPolicy&& policy, const Iterable& c, Pred p)
+{
+    if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+        const auto par = internal::as_parallel(policy);
+        if constexpr (internal::is_comparison<Pred>::value) {
+            if constexpr (internal::simd_countable<Iterable, decltype(p.value)>)
+                return internal::parallel_count<Pred::op>(par, c, p.value);
+        }
+        if constexpr (internal::random_access_range<Iterable>) {
+            if (internal::is_worth_parallel(c, par))
+                return internal::parallel_count_if(par, c, p);
+        }
+    }
+    return zen::count_if(c, p);
+}
+#endif
 
-private:
-    using my = stack<T, C>;
-};
+///////////////////////////////////////////////////////////////////////////////////////////// LPS (Log, Print, String)
+// 
+// Printing and logging in Kaizen follows the LPS principle of textual visualization.
+// The LPS principle: from string to print to log. This means that:
+// 1. to_string() - is the transformation of an object into a string
+// 2. print()     - uses to_string() to output the object (as a string)
+// 3. log()       - uses print() and adds any formatting, new lines at the end, etc.
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::string
+// ------------------------------------------------------------------------------------------ stringify
 
-class string : public std::string, private zen::stackonly
-{
-public:
-    using std::string::string;    // inherit constructors,         has to be explicit
-    using std::string::operator=; // inherit assignment operators, has to be explicit
+namespace internal {
+    // All textual conversions funnel into append_to(), which writes into one caller-owned
+    // buffer: nested containers, tuples and variadic arguments grow the same string instead
+    // of building (and concatenating) a temporary string per element.
+    template<class T>              void append_to(std::string& out, const T& x);
+    template<class T1, class T2>   void append_to(std::string& out, const std::pair<T1, T2>& p);
+    template<class... Ts>          void append_to(std::string& out, const std::tuple<Ts...>& tup);
 
-    string(const std::string&     s) : std::string(s) {}
-    string(const std::string_view s) : std::string(s) {}
+    // Types with a member append_to(std::string&) const write themselves into the buffer
+    template<class T, class = void> struct has_append_to : std::false_type {};
 
-#if __cplusplus < 202303L // check pre-C++23, at which point std::string::contains() is standard
-    // SFINAE to ensure that this version is only enabled when Pred is callable
-    template<class Pred, typename = std::enable_if_t<std::is_invocable_r_v<bool, Pred, char>>>
-    bool contains(const Pred& p)            const { return std::find_if(my::begin(), my::end(), p) != my::end(); }
-    bool contains(const std::string_view s) const { return find(s) != std::string::npos; }
-#endif
+    template<class T>
+    struct has_append_to<T,
+        std::void_t<decltype(std::declval<const T&>().append_to(std::declval<std::string&>()))>
+    > : std::true_type {};
 
-    bool is_empty() const { return my::empty(); }
+    // std::string_view only converts to std::string explicitly, so is_string_like() misses it
+    template<class T>
+    constexpr bool is_text_v = is_string_like<T>() || std::is_convertible_v<const T&, std::string_view>;
 
-    // std::string s = "[EXTRACTME]"; 
-    //                   ^^^^^^^^^
-    // Example: s.extract_between("[", "]");
-    zen::string extract_between(const std::string_view beg, const std::string_view end) const
+    // Elements of containers and tuples that are strings appear in quotes
+    template<class T>
+    void append_element(std::string& out, const T& x)
     {
-        const size_t posBeg = find(beg);
-        if (posBeg == std::string::npos) return ""; // signals 'not found'
-        const size_t posEnd = find(end, posBeg + 1);
-        if (posEnd == std::string::npos) return ""; // signals 'not found'
-        return substr(posBeg + 1, posEnd - posBeg - 1);
+        if constexpr (is_text_v<T>) {
+            out += '\"';
+            append_to(out, x);
+            out += '\"';
+        } else {
+            append_to(out, x);
+        }
     }
 
-    zen::string extract_pattern(const std::string& pattern)
+    template<class T>
+    void append_to(std::string& out, const T& x)
     {
-        const std::regex regex_pattern(pattern);
-        std::smatch match;
-        std::string in(my::begin(), my::end());
-
-        if (std::regex_search(in,   match, regex_pattern)) {
-            const size_t startPos = match.position(0);
-            const size_t length   = match.length(0);
+        using U = std::remove_cv_t<T>;
 
-            // Create a sub-string_view using the position and length
-            return std::string(my::data() + startPos, length);
+        // First check for string-likeness so that zen::print("abc") prints "abc"
+        // and not [a, b, c] as a result of considering strings as iterable below
+        if constexpr (is_text_v<U>) {
+            if constexpr (std::is_convertible_v<const U&, std::string_view>)
+                out.append(std::string_view(x));
+            else
+                out.append(std::string(x));
+        } else if constexpr (std::is_same_v<U, bool>) {
+            out += x ? '1' : '0'; // same as the default std::ostream output
+        } else if constexpr (std::is_same_v<U, char> || std::is_same_v<U, signed char> || std::is_same_v<U, unsigned char>) {
+            out += static_cast<char>(x);
+        } else if constexpr (std::is_arithmetic_v<U>) {
+            // std::to_chars with 'general' format and precision 6 produces exactly what
+            // the default std::ostream << does (printf's %g), minus the locale and stream
+            char buf[64];
+            std::to_chars_result res;
+            if constexpr (std::is_floating_point_v<U>)
+                res = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::general, 6);
+            else
+                res = std::to_chars(buf, buf + sizeof(buf), x);
+            out.append(buf, res.ptr);
+        } else if constexpr (has_append_to<U>::value) {
+            x.append_to(out); // types that know how to write themselves, like colored text
+        } else if constexpr (is_iterable_v<U>) {
+            out += '[';
+            auto it = std::begin(x);
+            if (it != std::end(x))
+                append_element(out, *it++);   // recursive call to handle nested iterables
+            for (; it != std::end(x); ++it) {
+                out += ", ";
+                append_element(out, *it);     // recursive call to handle nested iterables
+            }
+            out += ']';
+        } else { // not iterable, single item of a type that knows how to stream itself
+            std::ostringstream ss;
+            ss << x;
+            out += ss.str();
         }
-
-        return ""; // signals 'no match'
     }
 
-    zen::string& remove(const std::string& pattern)
+    template<class T1, class T2>
+    void append_to(std::string& out, const std::pair<T1, T2>& p)
     {
-        *this = std::regex_replace(*this, std::regex(pattern), std::string(""));
-        return *this; // for natural chaining
+        out += '{';
+        append_element(out, p.first);
+        out += ", ";
+        append_element(out, p.second);
+        out += '}';
     }
 
-    auto extract_version()   { return extract_pattern(R"((\d+)\.(\d+)\.(\d+)\.(\d+))"                          ); } // Like "X.Y.Z.B"
-    auto extract_date()      { return extract_pattern(R"((\d+\/\d+\/\d+))"                                     ); } // Like "31/12/2021"
-    auto extract_email()     { return extract_pattern(R"((\b[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\.[A-Za-z]{2,}\b))"); }
-    auto extract_url()       { return extract_pattern(R"((https?://[^\s]+))"                                   ); }
-    auto extract_hashtag()   { return extract_pattern(R"((#\w+))"                                              ); } // Like "#event"
-    auto extract_extension() { return extract_pattern(R"((\.\w+$))"                                            ); }
-
-    // Modifying functions
-    auto& prefix(const std::string_view s)
+    template<class... Ts>
+    void append_to(std::string& out, const std::tuple<Ts...>& tup)
     {
-        insert(0, s);
-        return *this;
+        out += '{';
+        std::apply([&out](const auto&... args) {
+            size_t n = 0;
+            ((out += (n++ ? ", " : ""), append_element(out, args)), ...);
+        }, tup);
+        out += '}';
     }
 
-    // Behaves like JavaScript's string.replace()
-    auto& replace(const std::string& search, const std::string& replacement) {
-        const size_t position = std::string::find(search);
-        if (position != std::string::npos) {
-            std::string::replace(position, search.length(), replacement);
-        }
-        return *this;
-    }
+    // Lets any type to_string() understands be passed to std::format(), see zen::show()
+    template<class T>
+    struct shown { const T& ref; };
+} // namespace internal
 
-    template <typename Pred>
-    auto& replace_if(const std::string& search, const std::string& replacement, Pred predicate)
-    {
-        if (search.empty()) return *this;
+// Appends the string forms of the arguments, separated by spaces, to an existing
+// buffer. Reusing one buffer across calls avoids allocating once it has grown.
+// Example: std::string line;
+//          zen::to_string_into(line, "Trial", 3, v);
+// Result:  line == "Trial 3 [1, 2, 3]"
+template<class T, class... Args>
+std::string& to_string_into(std::string& out, const T& x, const Args&... args)
+{
+    internal::append_to(out, x);
+    ((out += ' ', internal::append_to(out, args)), ...);
+    return out;
+}
 
-        static_assert(std::is_invocable<Pred, const std::string&>(),
-            "TEMPLATE PARAMETER Pred MUST BE CALLABLE WITH const std::string&, BUT IS NOT");
-        static_assert(std::is_same_v<std::invoke_result_t<Pred, const std::string&>, bool>,
-            "TEMPLATE PARAMETER Pred MUST RETURN bool, BUT DOES NOT");
+// Converts most of the widely used data types to a string.
+// Example: std::vector<int> v = {1, 3, 3};
+// Example: to_string(vec) Result: [1, 2, 3]
+// Example: to_string(42)  Result: "42"
+template<class T>
+zen::string to_string(const T& x) {
+    zen::string s;
+    internal::append_to(s, x);
+    return s;
+}
 
-        const size_t position = std::string::find(search);
-        if (position != std::string::npos && predicate(*this)) {
-            std::string::replace(position, search.length(), replacement);
-        }
-        return *this;
-    }
+// Multiple arguments are joined by spaces into a single buffer
+template<class T, class... Args>
+inline zen::string to_string(const T& x, const Args&... args) {
+    zen::string s;
+    to_string_into(s, x, args...);
+    return s;
+}
+// Base case for the recursive calls
+inline zen::string to_string() { return ""; }
 
-    // Behaves like JavaScript's string.replaceAll()
-    auto& replace_all(const std::string& search, const std::string& replacement)
-    {
-        if (search.empty()) return *this;
+// Wraps a value so that std::format() renders it the way to_string() does,
+// honoring the usual width, fill and alignment of the replacement field.
+// Example: std::format("{:>20}", zen::show(v)); // v is any iterable or tuple
+template<class T>
+internal::shown<T> show(const T& x) { return { x }; }
 
-        size_t pos = 0;
-        while ((pos = my::find(search, pos)) != std::string::npos) {
-            std::string::replace(pos, search.length(), replacement);
-            pos += replacement.length(); // move pos forward by the length of replace to prevent infinite loops
-        }
-        return *this;
-    }
+// ------------------------------------------------------------------------------------------ sink
 
-    template <typename Pred>
-    auto& replace_all_if(const std::string& search, const std::string& replacement, Pred predicate)
-    {
-        if (search.empty()) return *this;
+// How the text of print() and log() reaches the underlying stream (std::cout by default)
+enum class flush_policy {
+    none,     // write through without flushing, the stream's own buffering decides (default)
+    buffered, // collect text in the sink and write it out on flush(), when full or at exit
+    line,     // flush the stream after every complete line, like std::endl does
+};
 
-        static_assert(std::is_invocable<Pred, const std::string&>(),
-            "TEMPLATE PARAMETER Pred MUST BE CALLABLE WITH const std::string&, BUT IS NOT");
-        static_assert(std::is_same_v<std::invoke_result_t<Pred, const std::string&>, bool>,
-            "TEMPLATE PARAMETER Pred MUST RETURN bool, BUT DOES NOT");
+// The single destination of print() and log(). Every call hands the sink one
+// already formatted piece of text, so a logged line costs one write, not one
+// per argument plus a flush. In the 'buffered' policy text written directly to
+// std::cout may overtake text that is still sitting in the sink.
+// Example: zen::sink().set_policy(zen::flush_policy::buffered);
+//          for (...) zen::log("Trial", i, result); // no console I/O here
+//          zen::flush();                           // or simply at exit
+class output_sink {
+public:
+    explicit output_sink(std::ostream& os = std::cout, size_t capacity = 64 * 1024)
+        : os_(&os), capacity_(capacity) {}
 
-        size_t pos = 0;
-        while ((pos = my::find(search, pos)) != std::string::npos) {
-            if (predicate(*this)) {
-                std::string::replace(pos, search.length(), replacement);
-                pos += replacement.length(); // move pos forward by the length of replace to prevent infinite loops
-            } else {
-                pos += search.length(); // move pos forward by the length of search
-            }
-        }
-        return *this;
-    }
+    ~output_sink() { flush(); }
 
-    auto& trim_from_last(const std::string_view str)
+    output_sink(const output_sink&)            = delete;
+    output_sink& operator=(const output_sink&) = delete;
+
+    void write(const std::string_view s)
     {
-        *this = substr(0, rfind(str));
-        return *this;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (policy_ == flush_policy::buffered) {
+            if (buffer_.size() + s.size() > capacity_)
+                drain();
+            if (s.size() >= capacity_)
+                os_->write(s.data(), static_cast<std::streamsize>(s.size())); // too big to be worth buffering
+            else
+                buffer_.append(s);
+            return;
+        }
+        os_->write(s.data(), static_cast<std::streamsize>(s.size()));
+        if (policy_ == flush_policy::line && !s.empty() && s.back() == '\n')
+            os_->flush();
     }
 
-    auto& trim()
+    void flush()
     {
-        // Trim leading and trailing spaces
-        my::assign(std::regex_replace(*this, std::regex("^\\s+|\\s+$"), std::string("")));
-        return *this; // for natural chaining
+        std::lock_guard<std::mutex> lock(mutex_);
+        drain();
+        os_->flush();
     }
 
-    bool is_trimmed()
+    // Both setters write out what was buffered under the old settings first, under
+    // the same lock as the write() calls of other threads
+    void set_policy(flush_policy p)
     {
-        return !::isspace(my::front()) &&!::isspace(my::back());
+        std::lock_guard<std::mutex> lock(mutex_);
+        drain();
+        os_->flush();
+        policy_ = p;
     }
 
-    auto& deflate()
+    flush_policy policy() const
     {
-        // Replace any & all multiple spaces with a single space
-        my::assign(std::regex_replace(my::trim(), std::regex("\\s+"), " "));
-        return *this; // for natural chaining
+        std::lock_guard<std::mutex> lock(mutex_);
+        return policy_;
     }
 
-    bool is_deflated() const
+    // Redirects the sink, e.g. to a file or a std::ostringstream
+    void set_stream(std::ostream& os)
     {
-        auto neighbor_spaces = [](char a, char b) { return std::isspace(a) && std::isspace(b); };
-        return my::end() == std::adjacent_find(my::begin(), my::end(), neighbor_spaces);
+        std::lock_guard<std::mutex> lock(mutex_);
+        drain();
+        os_->flush();
+        os_ = &os;
     }
 
-    auto substring(int i1, int i2) const
+private:
+    void drain()
     {
-        const int sz = static_cast<int>(size());
-
-        // If necessary, convert negative indices to positive
-        if (i1 < 0) i1 += sz;
-        if (i2 < 0) i2 += sz;
+        if (buffer_.empty()) return;
+        os_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear(); // keeps the capacity for the next round
+    }
 
-        // Clamp indices to valid range
-        i1 = std::clamp<int>(i1, 0, sz);
-        i2 = std::clamp<int>(i2, 0, sz);
+    std::ostream* os_;
+    std::string   buffer_;
+    size_t        capacity_;
+    flush_policy  policy_ = flush_policy::none;
+    mutable std::mutex mutex_;
+};
 
-        if (i2 <= i1) {
-            return zen::string(""); // empty string signals a negative result and is harmless
-        }
+// The sink used by print() and log(). Being a function-local static,
+// it's destroyed at exit, which writes out whatever it still holds.
+inline output_sink& sink()
+{
+    static output_sink s;
+    return s;
+}
 
-        return zen::string(substr(i1, i2 - i1));
-    }
+// Writes out everything print() and log() have buffered so far
+inline void flush() { sink().flush(); }
 
-    auto& pad_start(size_t target_length, const std::string& pad_string = " ")
+namespace internal {
+    // One formatting buffer per thread, so print() and log() only allocate while it grows.
+    // Calls from the destructors of thread_locals destroyed after it get 'fallback' instead.
+    inline std::string& line_buffer(std::string& fallback)
     {
-        if (pad_string.empty()) return *this;
+        struct buffer {
+            std::string line;
+            bool        destroyed = false;
+            ~buffer() { destroyed = true; }
+        };
+        thread_local buffer b;
+
+        std::string& line = b.destroyed ? fallback : b.line;
+        line.clear();
+        return line;
+    }
+} // namespace internal
 
-        const size_t current_length = my::size();
-        const size_t total_padding_needed = target_length > current_length ? target_length - current_length : 0;
+// ------------------------------------------------------------------------------------------ async log
+
+// An asynchronous back-end for log() and print(), for logging from code whose timing matters.
+// Each producing thread formats its line and copies it into its own lock-free
+// single-producer/single-consumer ring buffer; a background thread drains all
+// rings into zen::sink(). Memory is bounded by ring_bytes per logging thread and
+// a line that doesn't fit in its ring is dropped and counted, never waited for.
+// Lines of one thread keep their order, lines of different threads may not.
+// Example: zen::async_logger::instance().start();
+//          zen::log("Trial", trial, "sum", sum); // a copy into the ring, no I/O
+//          zen::async_logger::instance().stop(); // drains and joins
+//          zen::log("dropped:", zen::async_logger::instance().dropped());
+class async_logger {
+public:
+    static constexpr size_t ring_bytes = 64 * 1024; // per thread, a power of two
 
-        // Full pad strings
-        const size_t full_pads = total_padding_needed / pad_string.length();
+    static async_logger& instance()
+    {
+        static async_logger logger;
+        return logger;
+    }
 
-        // Remaining characters
-        const size_t remaining = total_padding_needed % pad_string.length();
+    ~async_logger() { stop(); }
 
-        // Generate the padding string
-        std::string padding;
-        for (size_t i = 0; i < full_pads; ++i) {
-            padding += pad_string;
-        }
-        padding += pad_string.substr(0, remaining);
+    async_logger(const async_logger&)            = delete;
+    async_logger& operator=(const async_logger&) = delete;
 
-        my::insert(0, padding);
+    // Switches log() to the asynchronous mode until stop() is called
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (worker_.joinable()) return;
 
-        return *this;
+        stopping_.store(false, std::memory_order_relaxed);
+        worker_ = std::thread([this] { run(); });
+        accepting_.store(true, std::memory_order_seq_cst);
+        active().store(true, std::memory_order_release);
     }
 
-    auto& pad_end(size_t target_length, const std::string& pad_string = " ")
+    // Switches log() back to writing synchronously, after writing out everything queued so far
+    void stop()
     {
-        if (pad_string.empty()) return *this;
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (!worker_.joinable()) return;
+
+        // A producer that saw the logger running may still be copying its line in.
+        // Once none is, every later push() sees it stopped (see push()). log() keeps
+        // calling push() until the end, which holds its lines back until the queued
+        // ones are written out.
+        accepting_.store(false, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> rings_lock(rings_mutex_);
+            for (const auto& r : rings_)
+                while (r->pushing.load(std::memory_order_seq_cst))
+                    std::this_thread::yield();
+        }
+        stopping_.store(true, std::memory_order_release);
+        worker_.join();
+        drain_all(); // lines pushed by threads that were racing with the switch
+        sink().flush();
+        active().store(false, std::memory_order_release);
+    }
+
+    bool is_running() const { return active().load(std::memory_order_acquire); }
 
-        while (my::size() < target_length) {
-            // Append as much of pad_string as will fit
-            my::append(pad_string, 0, std::min(pad_string.size(), target_length - my::size()));
+    // The producer side: lock-free, and never blocks while the logger runs. A line that
+    // doesn't fit in the thread's ring is dropped and counted in dropped(). Returns false,
+    // without queuing the line, if the logger isn't running, the caller then writing it
+    // out itself: after stop() has written out the lines queued before it, so that the
+    // lines of the thread keep their order, and from threads that are exiting.
+    bool push(const std::string_view line)
+    {
+        ring* const r = local_ring();
+        if (!r)
+            return false;
+        // Raised before checking accepting_, which stop() clears before waiting for it to drop
+        r->pushing.store(true, std::memory_order_seq_cst);
+        const bool running = accepting_.load(std::memory_order_seq_cst);
+        if (running)
+            r->push(line);
+        r->pushing.store(false, std::memory_order_release);
+        if (!running) {
+            std::lock_guard<std::mutex> lock(control_mutex_); // lets a stop() in progress finish
         }
+        return running;
+    }
 
-        return *this;
+    // Number of lines dropped so far because a thread's ring was full
+    uint64_t dropped() const
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        uint64_t n = retired_dropped_;
+        for (const auto& r : rings_)
+            n += r->dropped.load(std::memory_order_relaxed);
+        return n;
     }
 
-    auto& capitalize()
+    // Checked by log() on every call, so it's a plain flag rather than a call to instance()
+    static std::atomic<bool>& active()
     {
-        if (is_empty()) return *this;
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
 
-        if (std::isalpha(front()) && std::islower(front())) {
-            my::front() = static_cast<char>(std::toupper(my::front())); // capitalize the first character
+private:
+    // Constructs the sink first, if nobody has used it yet, so that it's destroyed after
+    // the logger, whose destructor still drains into it and flushes it
+    async_logger() { (void)sink(); }
+
+    // Byte ring of length-prefixed records. head_ is only written by the
+    // producer thread and tail_ only by the consumer, each on its own
+    // cache line so that the two sides don't keep stealing it from each other.
+    struct ring {
+        static constexpr size_t mask = ring_bytes - 1;
+        static_assert((ring_bytes & mask) == 0, "ring_bytes MUST BE A POWER OF TWO");
+
+        alignas(64) std::atomic<size_t>   head{0};
+        std::atomic<bool>                 pushing{false}; // producer is in push(), see stop()
+        alignas(64) std::atomic<size_t>   tail{0};
+        alignas(64) std::atomic<uint64_t> dropped{0};
+        std::atomic<bool>                 retired{false}; // owner thread has exited
+        std::unique_ptr<char[]>           bytes{new char[ring_bytes]};
+
+        bool push(const std::string_view line)
+        {
+            const uint32_t len  = static_cast<uint32_t>(line.size());
+            const size_t   h    = head.load(std::memory_order_relaxed);
+            const size_t   used = h - tail.load(std::memory_order_acquire);
+            if (sizeof(len) + len > ring_bytes - used) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            copy_in(h, &len, sizeof(len));
+            copy_in(h + sizeof(len), line.data(), len);
+            head.store(h + sizeof(len) + len, std::memory_order_release);
+            return true;
         }
 
-        for (size_t i = 1; i < my::size(); ++i) {
-            char& c = my::at(i);
-            if (std::isalpha(c) && std::isupper(c)) {
-                c = static_cast<char>(std::tolower(c));
+        // Consumer side: hands every complete record to f, returns whether there were any
+        template<class F>
+        bool pop_all(F&& f, std::string& scratch)
+        {
+            size_t       t = tail.load(std::memory_order_relaxed);
+            const size_t h = head.load(std::memory_order_acquire);
+            if (t == h) return false;
+
+            while (t != h) {
+                uint32_t len;
+                copy_out(t, &len, sizeof(len));
+                scratch.resize(len);
+                copy_out(t + sizeof(len), scratch.data(), len);
+                f(std::string_view(scratch));
+                t += sizeof(len) + len;
             }
+            tail.store(t, std::memory_order_release);
+            return true;
         }
 
-        return *this;
-    }
+        void copy_in(size_t pos, const void* src, size_t n)
+        {
+            const size_t at    = pos & mask;
+            const size_t first = std::min(n, ring_bytes - at);
+            std::memcpy(bytes.get() + at, src, first);
+            std::memcpy(bytes.get(), static_cast<const char*>(src) + first, n - first);
+        }
+
+        void copy_out(size_t pos, void* dst, size_t n) const
+        {
+            const size_t at    = pos & mask;
+            const size_t first = std::min(n, ring_bytes - at);
+            std::memcpy(dst, bytes.get() + at, first);
+            std::memcpy(static_cast<char*>(dst) + first, bytes.get(), n - first);
+        }
+    };
 
-    auto& to_lower() {
-        for (auto& c : *this) {
-            if (std::isalpha(c) && std::isupper(c)) {
-                c = static_cast<char>(std::tolower(c));
+    // Registers the calling thread's ring on its first push. Only this happens under
+    // a lock; the ring is retired, and later freed by the consumer, when the thread exits.
+    // Returns null from then on, for log() calls in the destructors of thread_locals
+    // destroyed later, which the consumer may have freed the ring before.
+    ring* local_ring()
+    {
+        struct owner {
+            ring* r      = nullptr;
+            bool  exited = false;
+            ~owner()
+            {
+                if (r) r->retired.store(true, std::memory_order_release);
+                r      = nullptr;
+                exited = true;
             }
+        };
+        thread_local owner local;
+
+        if (local.exited)
+            return nullptr;
+        if (!local.r) {
+            auto r = std::make_unique<ring>();
+            local.r = r.get();
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(std::move(r));
         }
-        return *this;
+        return local.r;
     }
 
-    auto& to_upper() {
-        for (auto& c : *this) {
-            if (std::isalpha(c) && std::islower(c)) {
-                c = static_cast<char>(std::toupper(c));
+    bool drain_all()
+    {
+        bool any = false;
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto it = rings_.begin(); it != rings_.end();) {
+            ring& r = **it;
+            const bool retired = r.retired.load(std::memory_order_acquire);
+            any |= r.pop_all([](std::string_view line) { sink().write(line); }, scratch_);
+            if (retired) { // nothing can be pushed anymore, and what was is written out
+                retired_dropped_ += r.dropped.load(std::memory_order_relaxed);
+                it = rings_.erase(it);
+            } else {
+                ++it;
             }
         }
-        return *this;
+        return any;
     }
 
-    auto& center(size_t width, char fillchar = ' ') {
-        if (width <= my::size()) return *this;
+    void run()
+    {
+        while (!stopping_.load(std::memory_order_acquire)) {
+            if (!drain_all())
+                std::this_thread::sleep_for(std::chrono::microseconds(200)); // idle, back off
+        }
+    }
 
-        const size_t padding = width - my::size();
-        const size_t left_padding  = padding / 2;
-        const size_t right_padding = padding - left_padding;
+    std::vector<std::unique_ptr<ring>> rings_;
+    mutable std::mutex                 rings_mutex_;
+    std::mutex                         control_mutex_;
+    std::thread                        worker_;
+    std::atomic<bool>                  stopping_{false};
+    std::atomic<bool>                  accepting_{false}; // push() queues lines, cleared first by stop()
+    uint64_t                           retired_dropped_ = 0;
+    std::string                        scratch_; // only used by the draining thread
+};
 
-        my::insert(0, left_padding, fillchar);
-        my::append(right_padding, fillchar);
+// ------------------------------------------------------------------------------------------ print
 
-        return *this;
-    }
+// Generic, almost Python-like print(). Works like this:
+// print("Hello", "World", vec, 42); // Output: Hello World [1, 2, 3] 42
+// print("Hello", "World", 24, vec); // Output: Hello World 24 [1, 2, 3]
+// print("Hello", vec, 42, "World"); // Output: Hello [1, 2, 3] 42 World
+// Goes the same way as log() (see below), so the two keep their order.
+template <class T, class... Args>
+void print(const T& x, const Args&... args) {
+    std::string  fallback;
+    std::string& line = internal::line_buffer(fallback);
+    to_string_into(line, x, args...);
+    if (internal::current_test)
+        internal::current_test->append(line); // held back until the test is over
+    else if (!async_logger::active().load(std::memory_order_relaxed) || !async_logger::instance().push(line))
+        sink().write(line);
+}
+// Base case for the recursive calls
+inline void print() {}
 
-    bool is_printable() const { return                std::all_of(my::begin(), my::end(), [](auto c) { return std::isprint(c); }); }
-    bool is_alnum()     const { return !is_empty() && std::all_of(my::begin(), my::end(), [](auto c) { return std::isalnum(c); }); }
-    bool is_alpha()     const { return !is_empty() && std::all_of(my::begin(), my::end(), [](auto c) { return std::isalpha(c); }); }
-    bool is_digit()     const { return !is_empty() && std::all_of(my::begin(), my::end(), [](auto c) { return std::isdigit(c); }); }
-    bool is_lower()     const { return !is_empty() && std::all_of(my::begin(), my::end(), [](auto c) { return std::islower(c); }); }
-    bool is_upper()     const { return !is_empty() && std::all_of(my::begin(), my::end(), [](auto c) { return std::isupper(c); }); }
-    bool is_space()     const { return !is_empty() && std::all_of(my::begin(), my::end(), [](auto c) { return std::isspace(c); }); }
+// ------------------------------------------------------------------------------------------ log
 
-    bool is_identifier() const
-    {
-        if (is_empty())
-            return false;
+// Generic, almost Python-like log(). Works similar to the print() function but ends
+// the line. The whole line, newline included, goes to the sink in a single write and
+// is only flushed if the sink's policy asks for it (std::endl used to flush every line).
+// While the async_logger runs, the line is queued for its background thread instead,
+// and inside a test run by zen::run_tests() it goes to the output of the test.
+template <class T, class... Args>
+void log(const T& x, const Args&... args) {
+    std::string  fallback;
+    std::string& line = internal::line_buffer(fallback);
+    to_string_into(line, x, args...) += '\n';
+    if (internal::current_test)
+        internal::current_test->append(line);
+    else if (!async_logger::active().load(std::memory_order_relaxed) || !async_logger::instance().push(line))
+        sink().write(line); // also when the logger stopped while the line was on its way
+}
+// Base case for the recursive calls
+inline void log() {}
 
-        if (!std::isalpha(front()) && front() != '_')
-            return false;
+// ------------------------------------------------------------------------------------------ trace
+
+// Structured, binary tracing for call rates at which even async text logging costs too
+// much. ZEN_TRACE checks its format string against its arguments at compile time, then
+// stores only a format id, a timestamp and the raw argument bytes. Turning records into
+// text is deferred to zen::trace_decoder, typically in another process reading a file.
+// Example: zen::tracer tr;
+//          ZEN_TRACE(tr, "trial {} took {} ns", trial, ns);   // compiles
+//          ZEN_TRACE(tr, "trial {} took {} ns", trial);       // does not compile
+//          std::ofstream f("run.ztrace", std::ios::binary);
+//          tr.save(f);
+//          ...
+//          zen::trace_decoder::decode(in, std::cout);         // "trial 3 took 1200 ns"
+// The binary format uses the native byte order, so decode on the same kind of machine.
+#define ZEN_TRACE(trace_to, format, ...) \
+    do { \
+        static const uint32_t zen_trace_format_id = zen::tracer::register_format(format); \
+        (trace_to).record(zen_trace_format_id, format __VA_OPT__(,) __VA_ARGS__); \
+    } while (0)
 
-        for (size_t i = 1; i < my::size(); ++i) {
-            const char& c = my::at(i);
-            if (!std::isalnum(c) && c != '_') {
-                return false;
+namespace internal {
+    // Counts the {} replacement fields, treating {{ and }} as escaped braces. Any other
+    // use of a brace throws, which inside a consteval call means a compilation error.
+    consteval size_t count_placeholders(const std::string_view fmt)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < fmt.size(); ++i) {
+            if (fmt[i] == '{') {
+                if (i + 1 < fmt.size() && fmt[i + 1] == '{') { ++i; continue; }
+                if (i + 1 < fmt.size() && fmt[i + 1] == '}') { ++i; ++n; continue; }
+                throw std::invalid_argument("ZEN TRACE FORMAT STRING: ONLY {} REPLACEMENT FIELDS ARE SUPPORTED");
+            }
+            if (fmt[i] == '}') {
+                if (i + 1 < fmt.size() && fmt[i + 1] == '}') { ++i; continue; }
+                throw std::invalid_argument("ZEN TRACE FORMAT STRING: UNMATCHED }");
             }
         }
-
-        return true;
+        return n;
     }
 
-    auto& ljust(int width, char fillchar = ' ')
+    // Argument type tags of the binary encoding
+    enum class trace_tag : uint8_t { i64, u64, f64, boolean, character, text };
+} // namespace internal
+
+// A format string whose number of {} fields is verified against Args at compile time
+template<class... Args>
+struct trace_format {
+    template<class S>
+    consteval trace_format(const S& s) : text(s)
     {
-        if (width < 0)
-            width = 0; // handle negative width gracefully
-
-        auto uwidth = static_cast<std::string::size_type>(width);
-        if (uwidth <= my::size())
-            return *this;
+        if (internal::count_placeholders(text) != sizeof...(Args))
+            throw std::invalid_argument("ZEN TRACE FORMAT STRING: NUMBER OF {} FIELDS DOESN'T MATCH THE ARGUMENTS");
+    }
+    std::string_view text;
+};
 
-        const size_t padding = uwidth - my::size();
-        my::append(padding, fillchar);
+// Collects trace records in memory. Not synchronized: use one tracer per thread.
+class tracer {
+public:
+    explicit tracer(size_t reserve_bytes = 1 << 20) { bytes_.reserve(reserve_bytes); }
 
-        return *this;
+    // Called once per ZEN_TRACE call site; ids are shared by all tracers
+    static uint32_t register_format(const std::string_view format)
+    {
+        auto& [mutex, formats] = dictionary();
+        std::lock_guard<std::mutex> lock(mutex);
+        formats.emplace_back(format);
+        return static_cast<uint32_t>(formats.size() - 1);
     }
 
-    auto& rjust(int width, char fillchar = ' ')
+    // The hot path: a handful of memcpy calls and no formatting
+    template<class... Args>
+    void record(uint32_t format_id, trace_format<std::type_identity_t<Args>...>, const Args&... args)
     {
-        if (width < 0)
-            width = 0; // handle negative width gracefully
-
-        auto uwidth = static_cast<std::string::size_type>(width);
-        if (uwidth <= my::size())
-            return *this;
-
-        const std::string::size_type padding = uwidth - my::size();
-        my::insert(0, padding, fillchar);
-
-        return *this;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        put(format_id);
+        put(static_cast<int64_t>(ns));
+        put(static_cast<uint8_t>(sizeof...(Args)));
+        (put_arg(args), ...);
     }
 
-    auto& rtrim()
+    const std::vector<char>& bytes() const { return bytes_; }
+    bool is_empty()                  const { return bytes_.empty(); }
+    void clear()                           { bytes_.clear(); }
+
+    // Writes the format dictionary followed by the records, the input of zen::trace_decoder
+    void save(std::ostream& os) const
     {
-        my::erase(
-            std::find_if(my::rbegin(), my::rend(),
-                [](int c) { return !std::isspace(c); }
-            ).base(),
-            my::end()
-        );
-        return *this;
+        auto& [mutex, formats] = dictionary();
+        std::lock_guard<std::mutex> lock(mutex);
+
+        os.write(magic, sizeof(magic));
+        write_pod(os, static_cast<uint32_t>(formats.size()));
+        for (const auto& f : formats) {
+            write_pod(os, static_cast<uint32_t>(f.size()));
+            os.write(f.data(), static_cast<std::streamsize>(f.size()));
+        }
+        write_pod(os, static_cast<uint64_t>(bytes_.size()));
+        os.write(bytes_.data(), static_cast<std::streamsize>(bytes_.size()));
     }
 
-    auto& ltrim()
+    static constexpr char magic[4] = { 'Z', 'T', 'R', 'C' };
+
+private:
+    template<class T>
+    void put(const T& x)
     {
-        my::erase(
-            my::begin(),
-            std::find_if(my::begin(), my::end(), [](int c) { return !std::isspace(c); })
-        );
-        return *this;
+        const size_t n = bytes_.size();
+        bytes_.resize(n + sizeof(T));
+        std::memcpy(bytes_.data() + n, &x, sizeof(T));
     }
 
-    auto partition(const std::string& separator) 
+    template<class T>
+    void put_arg(const T& x)
     {
-        if (separator.empty())
-            throw std::invalid_argument("STRING SEPARATOR CANNOT BE EMPTY");
-
-        const std::string_view sv(my::data(), my::size());
-        const size_t pos = my::find(separator);
-
-        if (pos == std::string::npos)
-            return std::make_tuple(sv, std::string_view(), std::string_view());
+        using internal::trace_tag;
+        if constexpr (is_string_like<T>()) {
+            const std::string_view s = x;
+            put(trace_tag::text);
+            put(static_cast<uint32_t>(s.size()));
+            bytes_.insert(bytes_.end(), s.begin(), s.end());
+        } else if constexpr (std::is_same_v<T, bool>) {
+            put(trace_tag::boolean);
+            put(static_cast<uint8_t>(x));
+        } else if constexpr (std::is_same_v<T, char>) {
+            put(trace_tag::character);
+            put(x);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            put(trace_tag::f64);
+            put(static_cast<double>(x));
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            put(trace_tag::i64);
+            put(static_cast<int64_t>(x));
+        } else if constexpr (std::is_integral_v<T>) {
+            put(trace_tag::u64);
+            put(static_cast<uint64_t>(x));
+        } else { // anything else is rendered right away, so prefer arithmetic arguments
+            put_arg(static_cast<const std::string&>(to_string(x)));
+        }
+    }
 
-        const std::string_view before = sv.substr(0, pos);
-        const std::string_view after  = sv.substr(pos + separator.length());
-        const std::string_view sep    = sv.substr(pos,  separator.length());
+    template<class T>
+    static void write_pod(std::ostream& os, const T& x) { os.write(reinterpret_cast<const char*>(&x), sizeof(T)); }
 
-        return std::make_tuple(before, sep, after);
-    }
+    using format_dictionary = std::pair<std::mutex, std::vector<std::string>>;
 
-    auto rpartition(const std::string& separator)
+    static format_dictionary& dictionary()
     {
-        if (separator.empty())
-            throw std::invalid_argument("STRING SEPARATOR CANNOT BE EMPTY");
+        static format_dictionary d;
+        return d;
+    }
 
-        const std::string_view sv(my::data(), my::size());
-        const size_t pos = my::rfind(separator);
+    std::vector<char> bytes_;
+};
 
-        if (pos == std::string::npos)
-            return std::make_tuple(sv, std::string_view(), std::string_view());
+// Turns what zen::tracer::save() wrote back into text, one line per record,
+// each prefixed with the nanoseconds elapsed since the first record.
+class trace_decoder {
+public:
+    static void decode(std::istream& is, std::ostream& os)
+    {
+        char magic[sizeof(tracer::magic)];
+        is.read(magic, sizeof(magic));
+        if (!is || !std::equal(std::begin(magic), std::end(magic), std::begin(tracer::magic)))
+            throw std::runtime_error("NOT A ZEN TRACE STREAM");
+
+        std::vector<std::string> formats(read_pod<uint32_t>(is));
+        for (auto& f : formats) {
+            f.resize(read_pod<uint32_t>(is));
+            is.read(f.data(), static_cast<std::streamsize>(f.size()));
+        }
 
-        const std::string_view before = sv.substr(0, pos);
-        const std::string_view after  = sv.substr(pos + separator.length());
-        const std::string_view sep    = sv.substr(pos,  separator.length());
+        std::vector<char> bytes(read_pod<uint64_t>(is));
+        is.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!is)
+            throw std::runtime_error("TRUNCATED ZEN TRACE STREAM");
 
-        return std::make_tuple(before, sep, after);
+        size_t  pos = 0;
+        int64_t t0  = 0;
+        std::string line;
+        std::vector<std::string> args;
+        while (pos < bytes.size()) {
+            const auto id   = take<uint32_t>(bytes, pos);
+            const auto ns   = take<int64_t>( bytes, pos);
+            const auto argc = take<uint8_t>( bytes, pos);
+            if (id >= formats.size())
+                throw std::runtime_error("CORRUPT ZEN TRACE STREAM: UNKNOWN FORMAT ID " + std::to_string(id));
+            if (pos == sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint8_t))
+                t0 = ns; // first record
+
+            args.clear();
+            for (uint8_t i = 0; i < argc; ++i)
+                args.push_back(take_arg(bytes, pos));
+
+            line.clear();
+            to_string_into(line, ns - t0, "");
+            substitute(line, formats[id], args);
+            line += '\n';
+            os.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
     }
 
-    std::vector<zen::string> split(const std::string& separator)
+private:
+    template<class T>
+    static T read_pod(std::istream& is)
     {
-        // TODO: Can be template to support any container
-        std::vector<zen::string> result;
-        std::string s(*this);
-        std::string token;
-        size_t pos = 0;
-        while ((pos = s.find(separator)) != std::string::npos) {
-            token = s.substr(0, pos);
-            result.push_back(token);
-            s.erase(0, pos + separator.length());
-        }
-        result.push_back(s);
-        return result;
+        T x{};
+        is.read(reinterpret_cast<char*>(&x), sizeof(T));
+        return x;
     }
 
-    std::vector<zen::string> split_lines()
+    template<class T>
+    static T take(const std::vector<char>& bytes, size_t& pos)
     {
-        std::vector<zen::string> lines;
-        std::istringstream f(*this);
-        std::string line;
-        while (std::getline(f, line)) {
-            lines.push_back(line);
-        }
-        return lines;
+        if (pos + sizeof(T) > bytes.size())
+            throw std::runtime_error("TRUNCATED ZEN TRACE RECORD");
+        T x;
+        std::memcpy(&x, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return x;
     }
 
-    auto& swapcase()
+    static std::string take_arg(const std::vector<char>& bytes, size_t& pos)
     {
-        for (auto& c : *this) {
-            if (std::isalpha(c)) {
-                c = std::islower(c) ? static_cast<char>(std::toupper(c)) : static_cast<char>(std::tolower(c));
+        using internal::trace_tag;
+        switch (take<trace_tag>(bytes, pos)) {
+            case trace_tag::i64:       return to_string(take<int64_t>( bytes, pos));
+            case trace_tag::u64:       return to_string(take<uint64_t>(bytes, pos));
+            case trace_tag::f64:       return to_string(take<double>(  bytes, pos));
+            case trace_tag::boolean:   return to_string(take<uint8_t>( bytes, pos) != 0);
+            case trace_tag::character: return std::string(1, take<char>(bytes, pos));
+            case trace_tag::text: {
+                const auto n = take<uint32_t>(bytes, pos);
+                if (pos + n > bytes.size())
+                    throw std::runtime_error("TRUNCATED ZEN TRACE RECORD");
+                pos += n;
+                return std::string(bytes.data() + pos - n, n);
             }
         }
-        return *this;
+        throw std::runtime_error("CORRUPT ZEN TRACE STREAM: UNKNOWN ARGUMENT TAG");
     }
 
-    bool is_ascii()
+    static void substitute(std::string& out, const std::string_view fmt, const std::vector<std::string>& args)
     {
-        for (char c : *this)
-            if (!isascii(c))
-                return false;
-        return true;
+        size_t next = 0;
+        for (size_t i = 0; i < fmt.size(); ++i) {
+            const char c = fmt[i];
+            const char d = i + 1 < fmt.size() ? fmt[i + 1] : '\0';
+            if (c == '{' && d == '}') {
+                if (next < args.size()) out += args[next++];
+                ++i;
+            } else if ((c == '{' || c == '}') && d == c) {
+                out += c; // escaped brace
+                ++i;
+            } else {
+                out += c;
+            }
+        }
     }
-
-private:
-    using my = zen::string;
 };
 
-struct string_hash {
-    size_t operator()(const zen::string& z) const {
-        return std::hash<std::string>()(z);
-    }
+///////////////////////////////////////////////////////////////////////////////////////////// ALLOCATION TRACKING
+//
+// Counts the heap allocations of every thread, to tell whether a timed region allocates.
+// The counting is done by replacements of the global operator new and delete, which
+// are compiled in when ZEN_TRACK_ALLOCATIONS is defined before including kaizen.h.
+// As the replacements are program-wide, that has to happen in one translation unit
+// only. Without it, the counters stay at zero.
+// Example: #define ZEN_TRACK_ALLOCATIONS
+//          #include "kaizen.h"
+//          ...
+//          {
+//              zen::allocation_guard guard("hot loop", zen::allocation_policy::forbid);
+//              ... // logs an error if anything in here allocates
+//          }
+//          zen::allocation_guard guard("timed loop", zen::allocation_policy::abort); // fails the run
+
+struct allocation_counts {
+    size_t allocations   = 0;
+    size_t deallocations = 0;
+    size_t bytes         = 0; // requested by the allocations
 };
 
-template <class Rep, class Period>
-std::string adaptive_duration(const std::chrono::duration<Rep, Period>& d)
-{
-    using namespace std::chrono;
-
-    auto duration_ns = duration_cast<nanoseconds>(d).count();
-
-    if (duration_ns >= 3600e9) return std::to_string(duration_cast<hours>       (d).count()) + " hours";
-    if (duration_ns >=   60e9) return std::to_string(duration_cast<minutes>     (d).count()) + " minutes";
-    if (duration_ns >=    1e9) return std::to_string(duration_cast<seconds>     (d).count()) + " seconds";
-    if (duration_ns >=    1e6) return std::to_string(duration_cast<milliseconds>(d).count()) + " milliseconds";
-    if (duration_ns >=    1e3) return std::to_string(duration_cast<microseconds>(d).count()) + " microseconds";
-
-    return std::to_string(duration_ns) + " nanoseconds";
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////// zen::timer
-
-class timer {
-public:
-    timer() : start_(std::chrono::high_resolution_clock::now()), 
-               stop_(std::chrono::high_resolution_clock::now())
-    {}
-
-    auto start() { start_ = std::chrono::high_resolution_clock::now(); return *this; }
-    auto stop()  {  stop_ = std::chrono::high_resolution_clock::now(); return *this; }
-
-    template<class Duration>
-    auto elapsed() const {
-        const auto now = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<Duration>(now - start_);
-    }
-
-    template<class Duration>
-    auto duration() const {
-        return std::chrono::duration_cast<Duration>(stop_ - start_);
+namespace internal {
+    // Constant-initialized and trivially destructible, so the thread_local needs neither a
+    // first-use initialization nor a registered destructor, and operator new can use it on
+    // any thread without allocating itself
+    inline allocation_counts& thread_allocation_counts()
+    {
+        thread_local allocation_counts counts;
+        return counts;
     }
+} // namespace internal
 
-    auto duration_string() const {
-        return adaptive_duration(duration<nsec>());
-    }
+#if defined(ZEN_TRACK_ALLOCATIONS)
+inline constexpr bool is_tracking_allocations = true;
+#else
+inline constexpr bool is_tracking_allocations = false;
+#endif
 
-    using nsec = std::chrono::nanoseconds;
-    using usec = std::chrono::microseconds;
-    using msec = std::chrono::milliseconds;
-    using sec  = std::chrono::seconds;
-    using min  = std::chrono::minutes;
-    using hrs  = std::chrono::hours;
-  //using d    = std::chrono::days;   // since C++20
-  //using w    = std::chrono::weeks;  // since C++20
-  //using m    = std::chrono::months; // since C++20
-  //using y    = std::chrono::years;  // since C++20
+// The counts of the calling thread since it started
+inline allocation_counts thread_allocations() { return internal::thread_allocation_counts(); }
 
-private:
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_;
-    std::chrono::time_point<std::chrono::high_resolution_clock>  stop_;
+enum class allocation_policy {
+    count,  // only counts
+    forbid, // logs an error when the guard goes out of scope if there were any allocations
+    abort,  // writes the error to stderr and aborts the program, for runs that must not pass
 };
 
-template<typename Duration = timer::nsec>
-auto measure_execution(std::function<void()> operation)
-{
-    timer t;
-    operation();
-    t.stop();
-    return t.duration<Duration>();
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_map
-
-template<
-    class K,
-    class V,
-    class H = std::hash<K>,
-    class E = std::equal_to<K>,
-    class A = std::allocator<std::pair<const K, V>>
->
-class unordered_map : public std::unordered_map<K, V, H, E, A>, private zen::stackonly
+// Counts the allocations of the calling thread during its lifetime, and reports
+// them on destruction according to its allocation_policy.
+class allocation_guard : private zen::stackonly
 {
 public:
-    using std::unordered_map<K, V, H, E, A>::unordered_map; // inherit constructors, has to be explicit
+    explicit allocation_guard(std::string_view region, allocation_policy policy = allocation_policy::count)
+        : region_(region), policy_(policy), start_(thread_allocations()) {}
 
-    unordered_map(const std::unordered_map<K, V, H, E, A>& u)
-        : std::unordered_map<K, V, H, E, A>(u) {}
+    allocation_guard(const allocation_guard&)            = delete;
+    allocation_guard& operator=(const allocation_guard&) = delete;
 
-    template<class Kx, class Vx, class Hx, class Ex, class Ax>
-    unordered_map(const std::unordered_map<Kx, Vx, Hx, Ex, Ax>& u)
-        : std::unordered_map<K, V, H, E, A>(u.begin(), u.end()) {}
+    ~allocation_guard()
+    {
+        if (policy_ == allocation_policy::count || allocations() == 0)
+            return;
+        const std::string counts = "(" + std::to_string(allocations()) + " allocations, " + std::to_string(bytes()) + " bytes)";
+        if (policy_ == allocation_policy::abort) {
+            zen::flush(); // what was printed so far goes out ahead of the error
+            std::fprintf(stderr, "ALLOCATION IN A NO-ALLOCATION REGION: %.*s %s\n",
+                static_cast<int>(region_.size()), region_.data(), counts.c_str());
+            std::abort();
+        }
+        zen::log(zen::color::red("ALLOCATION IN A NO-ALLOCATION REGION:"), region_, counts);
+    }
 
-    bool is_empty() const { return my::empty(); }
+    size_t allocations()   const { return thread_allocations().allocations   - start_.allocations; }
+    size_t deallocations() const { return thread_allocations().deallocations - start_.deallocations; }
+    size_t bytes()         const { return thread_allocations().bytes         - start_.bytes; }
 
 private:
-    using my = unordered_map<K, V, H, E, A>;
+    std::string_view  region_;
+    allocation_policy policy_;
+    allocation_counts start_;
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_multimap
-
-template<
-    class K,
-    class V,
-    class H = std::hash<K>,
-    class E = std::equal_to<K>,
-    class A = std::allocator<std::pair<const K, V>>
->
-class unordered_multimap : public std::unordered_multimap<K, V, H, E, A>, private zen::stackonly
-{
-public:
-    using std::unordered_multimap<K, V, H, E, A>::unordered_multimap; // inherit constructors, has to be explicit
-
-    unordered_multimap(const std::unordered_multimap<K, V, H, E, A>& u)
-        : std::unordered_multimap<K, V, H, E, A>(u) {}
-
-    template<class Kx, class Vx, class Hx, class Ex, class Ax>
-    unordered_multimap(const std::unordered_multimap<Kx, Vx, Hx, Ex, Ax>& u)
-        : std::unordered_multimap<K, V, H, E, A>(u.begin(), u.end()) {}
+///////////////////////////////////////////////////////////////////////////////////////////// PROFILING
+//
+// Named, nested timers that accumulate over many calls, for finding out where a
+// pipeline spends its time. A ZEN_PROFILE scope adds its duration to the entry of
+// its label under the scope that encloses it, so the same label under different
+// parents is counted apart. Every thread records into a table of its own, without
+// locks or read-modify-writes; report() merges the tables of all threads, running
+// or finished, by label path.
+// Example: for (int trial = 0; trial < trials; ++trial) {
+//              ZEN_PROFILE("trial");
+//              { ZEN_PROFILE("load");    load();    }
+//              { ZEN_PROFILE("compute"); compute(); }
+//          }
+//          zen::print(zen::profiler::instance().report());
+// Entering a label for the first time under a scope allocates its entry; after
+// that a scope costs two clock readings and a handful of plain stores.
+
+#define ZEN_CONCAT_IMPL(a, b) a##b
+#define ZEN_CONCAT(a, b) ZEN_CONCAT_IMPL(a, b)
+#define ZEN_PROFILE(label) zen::profile_scope ZEN_CONCAT(zen_profile_scope_, __LINE__)(label)
 
-    bool is_empty() const { return my::empty(); }
+namespace internal {
+    // The label of the innermost profile_scope of the thread, read by zen::sampler from
+    // its signal handler. Trivial and constant-initialized, so reading it there is safe.
+    inline thread_local const char* profile_label = nullptr;
+} // namespace internal
 
-private:
-    using my = unordered_multimap<K, V, H, E, A>;
+// The merged statistics of one label path
+struct profile_entry {
+    std::string path;  // the labels from the outermost scope down, joined by '/'
+    std::string label;
+    size_t      depth = 0;
+    uint64_t    count = 0;
+    std::chrono::nanoseconds total{};
+    std::chrono::nanoseconds min{};
+    std::chrono::nanoseconds max{};
+
+    std::chrono::nanoseconds mean() const { return count ? total / static_cast<int64_t>(count) : total; }
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_set
-
-template<
-    class T,
-    class H = std::hash<T>,
-    class E = std::equal_to<T>,
-    class A = std::allocator<T>
->
-class unordered_set : public std::unordered_set<T, H, E, A>, private zen::stackonly
-{
+class profiler {
 public:
-    using std::unordered_set<T, H, E, A>::unordered_set; // inherit constructors, has to be explicit
-
-    unordered_set(const std::unordered_set<T, H, E, A>& u)
-        : std::unordered_set<T, H, E, A>(u) {}
-
-    template<class Tx, class Hx, class Ex, class Ax>
-    unordered_set(const std::unordered_set<Tx, Hx, Ex, Ax>& u)
-        : std::unordered_set<T, H, E, A>(u.begin(), u.end()) {}
-
-    bool is_empty() const { return my::empty(); }
-
-private:
-    using my = unordered_set<T, H, E, A>;
-};
+    using clock = std::chrono::steady_clock;
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_multiset
+    static profiler& instance()
+    {
+        static profiler p;
+        return p;
+    }
 
-template<
-    class T,
-    class H = std::hash<T>,
-    class E = std::equal_to<T>,
-    class A = std::allocator<T>
->
-class unordered_multiset : public std::unordered_multiset<T, H, E, A>, private zen::stackonly
-{
-public:
-    using std::unordered_multiset<T, H, E, A>::unordered_multiset; // inherit constructors, has to be explicit
+    profiler(const profiler&)            = delete;
+    profiler& operator=(const profiler&) = delete;
 
-    unordered_multiset(const std::unordered_multiset<T, H, E, A>& u)
-        : std::unordered_multiset<T, H, E, A>(u) {}
+    // The table of one thread. Only its thread writes it; report() reads it from any
+    // thread, which is why entries are published with a release store of the size
+    // and why the statistics are relaxed atomics, written with plain load-store pairs.
+    class thread_table {
+    public:
+        static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+        struct node {
+            std::string           label;
+            uint32_t              parent       = none;
+            uint32_t              first_child  = none; // for the owning thread only
+            uint32_t              next_sibling = none; // for the owning thread only
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> total{0};
+            std::atomic<uint64_t> min{std::numeric_limits<uint64_t>::max()};
+            std::atomic<uint64_t> max{0};
+        };
+
+        thread_table() { append("", none); } // the root, the parent of the outermost scopes
+
+        // Makes the child 'label' of the current node current, returns the previous one
+        uint32_t enter(const std::string_view label)
+        {
+            const uint32_t parent = current_;
+            uint32_t* link = &at(parent).first_child;
+            while (*link != none && at(*link).label != label)
+                link = &at(*link).next_sibling;
+            if (*link == none) {
+                if (size() == chunk_size * max_chunks)
+                    return parent; // full: time it as part of its parent
+                *link = append(label, parent);
+            }
+            current_ = *link;
+            internal::profile_label = at(current_).label.c_str();
+            return parent;
+        }
 
-    template<class Tx, class Hx, class Ex, class Ax>
-    unordered_multiset(const std::unordered_multiset<Tx, Hx, Ex, Ax>& u)
-        : std::unordered_multiset<T, H, E, A>(u.begin(), u.end()) {}
+        void leave(const uint32_t parent, const clock::duration elapsed)
+        {
+            if (current_ != parent) {
+                node& n = at(current_);
+                const auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+                n.count.store(n.count.load(std::memory_order_relaxed) + 1,  std::memory_order_relaxed);
+                n.total.store(n.total.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+                if (ns < n.min.load(std::memory_order_relaxed)) n.min.store(ns, std::memory_order_relaxed);
+                if (ns > n.max.load(std::memory_order_relaxed)) n.max.store(ns, std::memory_order_relaxed);
+            }
+            current_ = parent;
+            internal::profile_label = parent == 0 ? nullptr : at(parent).label.c_str();
+        }
 
-    bool is_empty() const { return my::empty(); }
+        uint32_t    size() const { return size_.load(std::memory_order_acquire); }
+        const node& at(uint32_t i) const { return chunks_[i / chunk_size].load(std::memory_order_acquire)[i % chunk_size]; }
+        node&       at(uint32_t i)       { return chunks_[i / chunk_size].load(std::memory_order_acquire)[i % chunk_size]; }
 
-private:
-    using my = unordered_multiset<T, H, E, A>;
-};
+        ~thread_table()
+        {
+            for (auto& c : chunks_)
+                delete[] c.load();
+        }
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::vector
+    private:
+        // Nodes live in chunks that never move, so report() can read them while the table grows
+        static constexpr uint32_t chunk_size = 256;
+        static constexpr uint32_t max_chunks = 64;
 
-template<class T, class A = std::allocator<T>>
-class vector : public std::vector<T, A>, private zen::stackonly
-{
-public:
-    using std::vector<T, A>::vector; // inherit constructors, has to be explicit
+        uint32_t append(const std::string_view label, uint32_t parent)
+        {
+            const uint32_t i = size_.load(std::memory_order_relaxed);
+            if (i % chunk_size == 0)
+                chunks_[i / chunk_size].store(new node[chunk_size], std::memory_order_release);
+            node& n = at(i);
+            n.label  = label;
+            n.parent = parent;
+            size_.store(i + 1, std::memory_order_release);
+            return i;
+        }
 
-    vector(const std::vector<T, A>& v) : std::vector<T, A>(v) {}
+        std::atomic<node*>    chunks_[max_chunks] = {};
+        std::atomic<uint32_t> size_{0};
+        uint32_t              current_ = 0;
+    };
 
-    template<class Pred>
-    typename std::enable_if<std::is_invocable_r<bool, Pred, const T&>::value, bool>::type
-        contains(Pred p) const
+    // The table of the calling thread, registered on first use
+    static thread_table& local()
     {
-        return std::find_if(my::begin(), my::end(), p) != my::end();
+        thread_local std::shared_ptr<thread_table> table = instance().add_table();
+        return *table;
     }
 
-    bool contains(const T& x) const { return std::find(my::begin(), my::end(), x) != my::end(); }
-    
-    bool is_empty() const { return my::empty(); }
-
-private:
-    using my = vector<T, A>;
-};
+    // All entries merged over the threads, depth first, children in the order they were first seen
+    std::vector<profile_entry> entries() const
+    {
+        std::vector<profile_entry>              merged;
+        std::vector<std::vector<size_t>>        children{{}};
+        std::unordered_map<std::string, size_t> index;
+        merged.emplace_back(); // the root
+
+        for (const auto& table : tables()) {
+            std::vector<size_t> slot(table->size());
+            slot[0] = 0;
+            for (uint32_t i = 1; i < slot.size(); ++i) {
+                const auto&  n      = table->at(i);
+                const size_t parent = slot[n.parent];
+                std::string  path   = parent == 0 ? n.label : merged[parent].path + "/" + n.label;
+                auto [it, inserted] = index.try_emplace(path, merged.size());
+                if (inserted) {
+                    profile_entry e;
+                    e.path  = std::move(path);
+                    e.label = n.label;
+                    e.depth = merged[parent].depth + 1;
+                    e.min   = std::chrono::nanoseconds::max();
+                    merged.push_back(std::move(e));
+                    children.emplace_back();
+                    children[parent].push_back(it->second);
+                }
+                profile_entry& e = merged[slot[i] = it->second];
+                const uint64_t count = n.count.load(std::memory_order_relaxed);
+                if (count == 0) continue;
+                e.count += count;
+                e.total += std::chrono::nanoseconds(n.total.load(std::memory_order_relaxed));
+                e.min    = std::min(e.min, std::chrono::nanoseconds(n.min.load(std::memory_order_relaxed)));
+                e.max    = std::max(e.max, std::chrono::nanoseconds(n.max.load(std::memory_order_relaxed)));
+            }
+        }
 
-// One Linux system gave the warning: In the GNU C Library, "major" is defined
-// by <sys/sysmacros.h>. For historical compatibility, it is currently defined
-// by <sys / types.h> as well, but we plan to remove this soon. To use "major",
-// include < sys / sysmacros directly. If you did not intend to use a system-defined
-// macro "major", you should undefine it after including <sys/types.h>.
-// So we undefine them:
-#undef major
-#undef minor
+        std::vector<profile_entry> ordered;
+        std::vector<size_t> stack(children[0].rbegin(), children[0].rend());
+        while (!stack.empty()) {
+            const size_t i = stack.back();
+            stack.pop_back();
+            ordered.push_back(std::move(merged[i]));
+            if (ordered.back().count == 0)
+                ordered.back().min = {};
+            stack.insert(stack.end(), children[i].rbegin(), children[i].rend());
+        }
+        return ordered;
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////// zen::version
-// Example: zen::version v8("8.2.3.4567");
-// Example: zen::version v1(1, 2, 3, 4567);
-// v1.major() == 1;
-// v1.minor() == 2;
-// v1.patch() == 3;
-// v1.build() == 4567;
-class version : public std::array<int, 4> { 
-public:
-    version(int major, int minor, int patch, int build)
-        : std::array<int, 4>{major, minor, patch, build}
-    {}
+    // A table of the entries, indented by depth, with each total as a share of its parent's
+    std::string report() const
+    {
+        const auto all = entries();
+        size_t width = 24;
+        for (const auto& e : all)
+            width = std::max(width, 2 * (e.depth - 1) + e.label.size());
+
+        std::string out;
+        auto column = [&out](std::string s, size_t w) { out += std::string(w > s.size() ? w - s.size() : 0, ' ') + s; };
+        out += "label" + std::string(width - 5, ' ');
+        for (const char* h : { "count", "total", "mean", "min", "max", "% parent" })
+            column(h, std::string_view(h) == "count" ? 10 : 12);
+        out += '\n';
+
+        std::vector<const profile_entry*> parents; // the ancestors of the current entry
+        for (const auto& e : all) {
+            parents.resize(e.depth - 1);
+            out += std::string(2 * (e.depth - 1), ' ') + e.label + std::string(width - 2 * (e.depth - 1) - e.label.size(), ' ');
+            column(std::to_string(e.count), 10);
+            for (const auto d : { e.total, e.mean(), e.min, e.max })
+                column(format_duration(d), 12);
+            if (!parents.empty() && parents.back()->total.count() > 0) {
+                char share[16];
+                std::snprintf(share, sizeof(share), "%.1f%%", 100.0 * e.total.count() / parents.back()->total.count());
+                column(share, 12);
+            }
+            out += '\n';
+            parents.push_back(&e);
+        }
+        return out;
+    }
 
-    explicit version(const std::string& text)
+    // Zeroes the statistics, keeping the entries. Call it while no profiled scope is running.
+    void reset()
     {
-        static const std::regex rx_version{R"((\d+)\.(\d+)\.(\d+)\.(\d+))"};
-        if (std::smatch sm; std::regex_match(text, sm, rx_version)) {
-            at(0) = std::stoi(sm[1]);
-            at(1) = std::stoi(sm[2]);
-            at(2) = std::stoi(sm[3]);
-            at(3) = std::stoi(sm[4]);
-        } else {
-            throw std::invalid_argument{
-                // Any cost of typeid is likely to be dwarfed by the cost of the exception anyway
-                std::string(typeid(*this).name()) + " CONSTRUCTOR ARGUMENT STRING DOESN'T MATCH THE EXPECTED M.M.P.B PATTERN."
-            };
+        for (const auto& table : tables()) {
+            for (uint32_t i = 0; i < table->size(); ++i) {
+                auto& n = table->at(i);
+                n.count.store(0, std::memory_order_relaxed);
+                n.total.store(0, std::memory_order_relaxed);
+                n.min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+                n.max.store(0, std::memory_order_relaxed);
+            }
         }
     }
 
-    constexpr auto major() const { return at(0); }
-    constexpr auto minor() const { return at(1); }
-    constexpr auto patch() const { return at(2); }
-    constexpr auto build() const { return at(3); }
+private:
+    profiler() = default;
+
+    std::shared_ptr<thread_table> add_table()
+    {
+        auto table = std::make_shared<thread_table>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        tables_.push_back(table);
+        return table;
+    }
+
+    // The tables outlive their threads, so finished threads still show up in the report
+    std::vector<std::shared_ptr<thread_table>> tables() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tables_;
+    }
+
+    static std::string format_duration(const std::chrono::nanoseconds d)
+    {
+        const double ns = static_cast<double>(d.count());
+        char s[32];
+        if      (ns >= 1e9) std::snprintf(s, sizeof(s), "%.3f s",  ns / 1e9);
+        else if (ns >= 1e6) std::snprintf(s, sizeof(s), "%.3f ms", ns / 1e6);
+        else if (ns >= 1e3) std::snprintf(s, sizeof(s), "%.3f us", ns / 1e3);
+        else                std::snprintf(s, sizeof(s), "%.0f ns", ns);
+        return s;
+    }
+
+    mutable std::mutex                         mutex_;
+    std::vector<std::shared_ptr<thread_table>> tables_;
 };
 
-std::ostream& operator<<(std::ostream& os, const version& v)
+// Times its own lifetime under 'label', nested in the enclosing profile_scope of
+// the same thread. The label is copied the first time, so any string will do.
+class profile_scope : private zen::stackonly
 {
-    return os << v.major() << '.' << v.minor() << '.' << v.patch() << '.' << v.build();
-}
+public:
+    explicit profile_scope(const std::string_view label)
+        : table_(profiler::local()), parent_(table_.enter(label)), start_(profiler::clock::now()) {}
 
-namespace literals::version {
+    profile_scope(const profile_scope&)            = delete;
+    profile_scope& operator=(const profile_scope&) = delete;
 
-// Example: auto v7 = "7.6.5.4321"_version;
-zen::version operator""_version(const char* text, size_t)
-{
-    return zen::version{text};
-}
+    ~profile_scope() { table_.leave(parent_, profiler::clock::now() - start_); }
 
-} // namespace literals::version
+private:
+    profiler::thread_table&     table_;
+    uint32_t                    parent_;
+    profiler::clock::time_point start_;
+};
 
-///////////////////////////////////////////////////////////////////////////////////////////// USEFUL MISC
+// ------------------------------------------------------------------------------------------ sampling
+
+// A sampling profiler for when no external one can be run. While it's started,
+// SIGPROF interrupts the process every 1/frequency seconds of CPU time (setitimer
+// with ITIMER_PROF), and the handler records the interrupted instruction address
+// together with the innermost ZEN_PROFILE label of the interrupted thread. report()
+// resolves the addresses to function names with dladdr(), grouped by label, which
+// makes a hotspot list per profiled kernel. Linux only; elsewhere it records nothing.
+// dladdr() only sees exported symbols, so link executables with -rdynamic (CMake's
+// ENABLE_EXPORTS); other addresses are reported as module+offset. The timer works
+// at the kernel's tick granularity, which can be coarser than the frequency asked for.
+// Example: zen::sampler::instance().start(1000);
+//          for (...) { ZEN_PROFILE("sum_aligned"); ... }
+//          zen::sampler::instance().stop();
+//          zen::print(zen::sampler::instance().report());
+class sampler {
+public:
+#if defined(__linux__)
+    static constexpr bool is_supported = true;
+#else
+    static constexpr bool is_supported = false;
+#endif
 
-// Repeats a string patterns.
-// This is the symmetrical complement of repeat(int, str).
-// Example: repeat("*", 10);
-// Result:  "**********"
-zen::string repeat(const std::string_view s, const int n) {
-    std::string result;
-    for (int i = 0; i < n; i++) {
-        result += s;
-    }
-    return result;
-}
+    struct sample {
+        const void* address; // the interrupted instruction
+        const char* label;   // the innermost ZEN_PROFILE scope, or nullptr
+    };
 
-// This is the symmetrical complement of repeat(str, int).
-// Repeats a string patterns.
-// Example: repeat(10, "*");
-// Result:  "**********"
-zen::string repeat(const int n, const std::string_view s) {
-    std::string result;
-    for (int i = 0; i < n; i++) {
-        result += s;
+    static sampler& instance()
+    {
+        static sampler s;
+        return s;
     }
-    return result;
-}
 
-///////////////////////////////////////////////////////////////////////////////////////////// MAIN UTILITIES
+    sampler(const sampler&)            = delete;
+    sampler& operator=(const sampler&) = delete;
 
-// Example: random_int();
-// Result: A random integer between [min, max)
-template<class T = int>
-T random_int(const T min = 0, const T max = 10) {
-    // Reasons why the std::random_device and the std::mt19937 are 'static' below:
-    // ---------------------------------------------------------------------------------------------------------------
-    // 1. Initialization Efficiency:
-    // Random devices and generators often involve some computational cost due to entropy gathering, seeding, generator
-    // initialization and good old algorithmic complexity. By declaring them as static, they are initialized only once,
-    // the first time the function is called. Subsequent calls to to this function reuse the existing instances, avoiding the overhead.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 2. State Preservation:
-    // Random number generators like std::mt19937 maintain an internal state that evolves as numbers are generated.
-    // This state determines the sequence of random numbers produced. By making the std::mt19937 object static,
-    // the state is preserved across calls to this function, ensuring a proper random sequence. If the std::mt19937
-    // object were reinitialized on every call, it might lead to repeated or patterned sequences, undermining the randomness.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 3. Thread Safety Considerations:
-    // Declaring these variables as static within a function means they are shared across all calls to that function
-    // within the program, regardless of where it's called from. This could potentially raise thread-safety issues if the
-    // function is called simultaneously from multiple threads. However, in most common usage scenarios where thread
-    // safety is not a concern, using static variables for this purpose is fine.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 4. Resource Management
-    // Since the std::random_device and the std::mt19937 object are static, they are not destroyed when the function returns,
-    // but rather when the program ends. This ensures that the same random device and generator instances are reused
-    // throughout the lifetime of the program, optimizing resource management.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 5. Avoiding Repetition
-    // If we didn't make these objects static, and the random number generator was reseeded with the same or similar
-    // seeds (which might happen if the function is called in quick succession), you might get the same or similar random
-    // numbers in different calls. Making these static ensures a more varied and truly random sequence.
-    // ---------------------------------------------------------------------------------------------------------------
-    // The 'static' below is for reasons outlined above.
-    static std::random_device        rd;
-    static std::mt19937              gen(rd());
-    std::uniform_int_distribution<T> dis(min, max);
-    return dis(gen);
-}
+    ~sampler() { stop(); }
 
-// Very often all we want is a dead simple way of quickly
-// generating a container filled with some random numbers.
-// Example: std::vector<int> v;
-//          zen::generate_random(v);
-// Result: A vector of size 10 with random integers between [min, max)
-template<class Iterable>
-void generate_random(Iterable& c, int size = 10) // TODO: Maybe generalize this to make it work with all containers
-{
-    ZEN_STATIC_ASSERT(zen::is_iterable_v< Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
-    ZEN_STATIC_ASSERT(zen::is_resizable_v<Iterable>, "TEMPLATE PARAMETER EXPECTED TO BE RESIZABLE, BUT IS NOT");
+    // Starts sampling, discarding the samples of earlier runs. Up to 'capacity'
+    // samples are kept, the ones after that are counted as dropped.
+    void start(unsigned frequency = 1000, size_t capacity = 1 << 16)
+    {
+        if (frequency == 0)
+            throw std::invalid_argument("SAMPLING FREQUENCY MUST BE POSITIVE");
+        stop();
+        samples_.reset(new sample[capacity]);
+        capacity_  = capacity;
+        frequency_ = frequency;
+        size_.store(0, std::memory_order_relaxed);
+#if defined(__linux__)
+        struct sigaction action = {};
+        action.sa_sigaction = &sampler::on_signal;
+        action.sa_flags     = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, &previous_) != 0)
+            throw std::runtime_error("CANNOT INSTALL THE SIGPROF HANDLER");
+
+        // tv_usec has to stay below a second, so start(1) takes tv_sec
+        const long interval = std::max<long>(1, 1'000'000 / static_cast<long>(frequency)); // in microseconds
+        itimerval timer = {};
+        timer.it_interval.tv_sec  = interval / 1'000'000;
+        timer.it_interval.tv_usec = interval % 1'000'000;
+        timer.it_value            = timer.it_interval;
+        if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+            sigaction(SIGPROF, &previous_, nullptr);
+            throw std::runtime_error("CANNOT START THE PROFILING TIMER");
+        }
+        running_ = true;
+#endif
+    }
 
-    if (std::empty(c))
-        c.resize(size);
+    void stop()
+    {
+#if defined(__linux__)
+        if (!running_) return;
+        itimerval timer = {};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+
+        // A SIGPROF raised before the timer was disarmed can still be pending (on a
+        // thread blocking it, say), and the previous disposition is usually the default
+        // one, which terminates the process. Ignoring the signal discards pending ones.
+        struct sigaction ignore = {};
+        ignore.sa_handler = SIG_IGN;
+        sigemptyset(&ignore.sa_mask);
+        sigaction(SIGPROF, &ignore, nullptr);
+        sigaction(SIGPROF, &previous_, nullptr);
+        running_ = false;
+#endif
+    }
 
-    std::generate(std::begin(c), std::end(c), [&]() { return random_int(10, 99); });
-}
+    bool is_running() const { return running_; }
 
-// Over the years it has become clear that the standard member
-// function empty() that lacks an 'is_' prefix is confusing to
-// non-familiar users due to its ambiguity as a noun and a verb.
-// Example: zen::is_empty(c); // c is any iterable container
-template<class HasEmpty>
-bool is_empty(const HasEmpty& c)
-{
-    ZEN_STATIC_ASSERT(zen::has_empty_v<HasEmpty>, "TEMPLATE PARAMETER EXPECTED TO HAVE empty(), BUT DOES NOT");
-    return c.empty();
-}
+    size_t size()    const { return std::min(size_.load(std::memory_order_acquire), capacity_); }
+    size_t dropped() const { return size_.load(std::memory_order_acquire) - size(); }
 
-// TODO: Think of a way to use the Addable concept in addition
-// to Iterable that will not make the resulting code too ugly.
-template<class Iterable>
-auto sum(const Iterable& c)
-{
-    ZEN_STATIC_ASSERT(is_iterable_v<Iterable>,         "TEMPLATE PARAMETER EXPECTED TO BE Iterable, BUT IS NOT");
-    ZEN_STATIC_ASSERT(is_addable_v<decltype(*std::begin(c))>, "ELEMENT TYPE EXPECTED TO BE Addable, BUT IS NOT");
+    // The recorded samples; read them after stop()
+    std::span<const sample> samples() const { return { samples_.get(), size() }; }
 
-    if (c.empty()) {
-        return decltype(*std::begin(c)){}; // zero-initialized value for empty containers
+    // The samples per label, and per label the functions they fell in, most sampled first
+    std::string report(size_t functions_per_label = 10) const
+    {
+        if (!is_supported)
+            return "sampling isn't supported on this platform\n";
+
+        std::unordered_map<const void*, std::string> names;
+        std::map<std::string, std::map<std::string, size_t>> hits; // label -> function -> samples
+        for (const sample& s : samples()) {
+            auto it = names.find(s.address);
+            if (it == names.end())
+                it = names.emplace(s.address, symbol_name(s.address)).first;
+            ++hits[s.label ? s.label : "(outside of profiled scopes)"][it->second];
+        }
+
+        std::vector<std::pair<size_t, const std::string*>> labels;
+        for (const auto& [label, functions] : hits) {
+            size_t n = 0;
+            for (const auto& f : functions) n += f.second;
+            labels.emplace_back(n, &label);
+        }
+        std::sort(labels.begin(), labels.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        char line[64];
+        std::snprintf(line, sizeof(line), " at %u Hz (%zu dropped)\n", frequency_, dropped());
+        std::string out = std::to_string(size()) + " samples" + line;
+        for (const auto& [n, label] : labels) {
+            std::snprintf(line, sizeof(line), ": %zu samples (%.1f%%)\n", n, 100.0 * n / size());
+            out += *label + line;
+
+            std::vector<std::pair<size_t, const std::string*>> functions;
+            for (const auto& [name, k] : hits.at(*label))
+                functions.emplace_back(k, &name);
+            std::sort(functions.begin(), functions.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+            if (functions.size() > functions_per_label)
+                functions.resize(functions_per_label);
+            for (const auto& [k, name] : functions) {
+                std::snprintf(line, sizeof(line), "  %6.1f%%  ", 100.0 * k / n);
+                out += line + *name + "\n";
+            }
+        }
+        return out;
     }
 
-    // By initializing 'sum' to the first element of the collection and not just the tempting 0,
-    // this function makes fewer assumptions about the type it's working with, thereby making
-    // this function more robust and generic since we're dealing with arbitrary addable types
-    // (which could be complex numbers, matrices, etc.).
-    auto sum = *std::begin(c);
-    for (auto it = std::next(std::begin(c)); it != std::end(c); ++it) {
-        sum += *it;
+    // The demangled name of the function containing 'address', or module+offset
+    static std::string symbol_name(const void* address)
+    {
+#if defined(__linux__)
+        Dl_info info;
+        if (dladdr(address, &info) == 0)
+            return to_hex(address);
+        if (info.dli_sname) {
+            int status = 0;
+            std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status), std::free);
+            return status == 0 ? demangled.get() : info.dli_sname;
+        }
+        if (info.dli_fname) {
+            const std::string_view module = info.dli_fname;
+            return std::string(module.substr(module.find_last_of('/') + 1)) + "+"
+                 + to_hex(reinterpret_cast<const void*>(static_cast<const char*>(address) - static_cast<const char*>(info.dli_fbase)));
+        }
+#endif
+        return to_hex(address);
     }
 
-    return sum;
-}
+private:
+    sampler() = default;
 
-template<class Iterable, class EqualityComparable>
-auto count(const Iterable& c, const EqualityComparable& x)
-{
-    ZEN_STATIC_ASSERT(is_iterable_v<Iterable>,
-        "TEMPLATE PARAMETER Iterable EXPECTED TO BE ITERABLE, BUT IS NOT");
-    ZEN_STATIC_ASSERT(is_equality_comparable_v<EqualityComparable>,
-        "TEMPLATE PARAMETER EqualityComparable EXPECTED TO BE EqualityComparable, BUT IS NOT");
+    static std::string to_hex(const void* p)
+    {
+        char s[2 + 2 * sizeof(void*) + 1];
+        std::snprintf(s, sizeof(s), "0x%zx", reinterpret_cast<size_t>(p));
+        return s;
+    }
 
-    size_t count = 0;
-    for (auto it = std::begin(c); it != std::end(c); ++it) {
-        if (*it == x)
-            ++count;
+#if defined(__linux__)
+    // Runs in the interrupted thread, so it does nothing but lock-free stores
+    static void on_signal(int, siginfo_t*, void* context)
+    {
+        sampler& self = instance();
+        const size_t i = self.size_.fetch_add(1, std::memory_order_relaxed);
+        if (i < self.capacity_)
+            self.samples_[i] = { instruction_pointer(context), internal::profile_label };
     }
 
-    return count;
-}
+    static const void* instruction_pointer(void* context)
+    {
+        const auto* uc = static_cast<const ucontext_t*>(context);
+#if defined(__x86_64__)
+        return reinterpret_cast<const void*>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__i386__)
+        return reinterpret_cast<const void*>(uc->uc_mcontext.gregs[REG_EIP]);
+#elif defined(__aarch64__)
+        return reinterpret_cast<const void*>(uc->uc_mcontext.pc);
+#else
+        (void)uc;
+        return nullptr;
+#endif
+    }
 
-template<class Iterable, class Pred>
-auto count_if(const Iterable& c, Pred p)
-{
-    using T = decltype(*std::begin(c));
-    ZEN_STATIC_ASSERT(is_iterable_v<Iterable>,
-        "TEMPLATE PARAMETER Iterable EXPECTED TO BE ITERABLE, BUT IS NOT");
-    ZEN_STATIC_ASSERT((std::is_invocable_r<bool, Pred, const T&>::value),
-        "TEMPLATE PARAMETER Predicate NOT APPLICABLE TO ELEMENT TYPE");
+    struct sigaction previous_ = {};
+#endif
 
-    size_t count = 0;
-    for (auto it = std::begin(c); it != std::end(c); ++it) {
-        if (p(*it))
-            ++count;
-    }
+    std::unique_ptr<sample[]> samples_;
+    size_t                    capacity_  = 0;
+    unsigned                  frequency_ = 0;
+    std::atomic<size_t>       size_{0};
+    bool                      running_   = false;
+};
 
-    return count;
-}
+///////////////////////////////////////////////////////////////////////////////////////////// TEST RUNNER
+//
+// Runs the tests registered with ZEN_TEST or zen::register_test() (see TESTING) on a
+// pool of threads. Every test collects whatever it prints or logs, ZEN_EXPECT failures
+// included, in an output of its own, which is written out in one piece together with
+// the verdict and the time of the test as soon as it's over. The output of tests that
+// run side by side therefore never interleaves. The filter is a comma-separated list
+// of name patterns, where '*' matches any run of characters and '?' any one of them;
+// a pattern starting with '-' excludes the tests it matches.
+// Example: int main(int argc, char* argv[]) {
+//              zen::cmd_args args(argv, argc);
+//              auto filter  = args.get_options("--filter");
+//              auto results = zen::run_tests(zen::execution::par, filter.empty() ? "*" : filter[0]);
+//              return results.failed() == 0 ? 0 : 1;
+//          }
+// Result:  PASS  version_parsing        0.042 ms   12 cases
+//          FAIL  string_trimming        0.013 ms    1 of 6 cases failed
+//          CASE FAIL: string_trimming EXPECTED: ...
+//          ...
+// Tests that share state without synchronizing it must be run with zen::execution::seq.
+// The threads that the zen::execution::par overloads start report to the test that called
+// them, but a std::thread the test starts itself doesn't: its ZEN_EXPECT failures only
+// reach TEST_CASE_FAIL_COUNT, its output goes straight to the sink, and the test can still
+// be reported PASS. Check the results of such threads on the thread of the test.
+
+struct test_result {
+    std::string              name;
+    std::chrono::nanoseconds duration{};
+    int                      passes = 0;
+    int                      fails  = 0;
+    std::string              error;  // the message of an exception that escaped the test
+    std::string              output; // what the test printed and logged
+
+    bool passed() const { return fails == 0 && error.empty(); }
+};
 
-///////////////////////////////////////////////////////////////////////////////////////////// LPS (Log, Print, String)
-// 
-// Printing and logging in Kaizen follows the LPS principle of textual visualization.
-// The LPS principle: from string to print to log. This means that:
-// 1. to_string() - is the transformation of an object into a string
-// 2. print()     - uses to_string() to output the object (as a string)
-// 3. log()       - uses print() and adds any formatting, new lines at the end, etc.
+// The results of a run, in the order the tests were registered
+struct test_results {
+    std::vector<test_result> tests;
+    std::chrono::nanoseconds duration{}; // of the whole run
+    unsigned                 threads = 1;
 
-// ------------------------------------------------------------------------------------------ stringify
+    size_t passed() const { return std::count_if(tests.begin(), tests.end(), [](const auto& t) { return t.passed(); }); }
+    size_t failed() const { return tests.size() - passed(); }
+};
 
-// Converts most of the widely used data types to a string.
-// Example: std::vector<int> v = {1, 3, 3};
-// Example: to_string(vec) Result: [1, 2, 3]
-// Example: to_string(42)  Result: "42"
-template<class T>
-zen::string to_string(const T& x) {
-    std::stringstream ss;
-    
-    // First check for string-likeness so that zen::pring("abc") prints "abc"
-    // and not [a, b, c] as a result of considering strings as iterable below
-    if constexpr (is_string_like<T>()) {
-        return x;
-    } else if constexpr (is_iterable_v<T>) {
-        ss << "[";
-        auto it = std::begin(x);
-        if (it != std::end(x)) {
-            if constexpr (is_string_like<decltype(*it)>())
-                ss << quote(to_string(*it++));
-            else
-                ss << to_string(*it++);              // recursive call to handle nested iterables
+namespace internal {
+    inline bool glob_match(const std::string_view pattern, const std::string_view text)
+    {
+        size_t p = 0, t = 0;
+        size_t star = std::string_view::npos, resume = 0; // where the last '*' may grow from
+        while (t < text.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+                ++p, ++t;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                resume = t;
+            } else if (star != std::string_view::npos) {
+                p = star + 1;
+                t = ++resume;
+            } else {
+                return false;
+            }
         }
-        for (; it != std::end(x); ++it) {
-            if constexpr (is_string_like<decltype(*it)>())
-                ss << ", " << quote(to_string(*it)); // recursive call to handle nested iterables
-            else
-                ss << ", " << to_string(*it);        // recursive call to handle nested iterables
+        while (p < pattern.size() && pattern[p] == '*')
+            ++p;
+        return p == pattern.size();
+    }
+
+    inline bool test_filter_match(const std::string_view filter, const std::string_view name)
+    {
+        bool any_include = false, included = false;
+        for (size_t begin = 0; begin <= filter.size(); ) {
+            const size_t end = std::min(filter.find(',', begin), filter.size());
+            std::string_view pattern = filter.substr(begin, end - begin);
+            begin = end + 1;
+            if (pattern.empty())
+                continue;
+            if (pattern.front() == '-') {
+                if (glob_match(pattern.substr(1), name))
+                    return false;
+            } else {
+                any_include = true;
+                included = included || glob_match(pattern, name);
+            }
         }
-        ss << "]";
-    } else { // not iterable, single item
-        ss << x;
+        return included || !any_include;
     }
-    return ss.str();
-}
 
-// Recursive variadic template to handle multiple arguments
-template<class T, class... Args>
-inline zen::string to_string(const T& x, const Args&... args) {
-    return to_string(x) + " " + to_string(args...);
-}
-// Base case for the recursive calls
-inline zen::string to_string() { return ""; }
+    inline test_result run_test(const test_case& test)
+    {
+        test_context context;
+        test_context* const outer = std::exchange(current_test, &context);
+        test_result result;
+        result.name = test.name;
+        zen::timer timer;
+        try {
+            test.function();
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        } catch (...) {
+            result.error = "UNKNOWN EXCEPTION";
+        }
+        timer.stop();
+        current_test = outer;
 
-// ------------------------------------------------------------------------------------------ print
+        result.duration = timer.duration();
+        result.passes   = context.passes.load();
+        result.fails    = context.fails.load();
+        result.output   = std::move(context.output);
+        return result;
+    }
 
-// Function to handle individual item printing
-template <class T>
-void print(const T& x)
-{
-    std::cout << to_string(x);
-}
+    inline std::string test_verdict(const test_result& r, size_t width)
+    {
+        char time[32];
+        std::snprintf(time, sizeof(time), "%12.3f ms", static_cast<double>(r.duration.count()) / 1e6);
+        std::string line;
+        (r.passed() ? color::green("PASS") : color::red("FAIL")).append_to(line);
+        line += "  " + r.name + std::string(width > r.name.size() ? width - r.name.size() : 0, ' ') + time + "  ";
+        if (r.fails > 0)
+            line += std::to_string(r.fails) + " of " + std::to_string(r.passes + r.fails) + " cases failed";
+        else
+            line += std::to_string(r.passes) + (r.passes == 1 ? " case" : " cases");
+        line += '\n';
+        if (!r.error.empty()) {
+            color::red("UNCAUGHT EXCEPTION:").append_to(line);
+            line += ' ' + r.error + '\n';
+        }
+        return line + r.output;
+    }
+} // namespace internal
 
-// Generic, almost Python-like print(). Works like this:
-// print("Hello", "World", vec, 42); // Output: Hello World [1, 2, 3] 42
-// print("Hello", "World", 24, vec); // Output: Hello World 24 [1, 2, 3]
-// print("Hello", vec, 42, "World"); // Output: Hello [1, 2, 3] 42 World
-template <class T, class... Args>
-void print(T x, Args... args) {
-    print(x);
-    if constexpr (sizeof...(args) != 0) {
-        std::cout << " ";
+// Runs the registered tests whose names match 'filter', one per thread of the policy at a time
+template<class ExecutionPolicy>
+    requires execution::is_execution_policy_v<ExecutionPolicy>
+test_results run_tests(const ExecutionPolicy& policy, const std::string_view filter = "*")
+{
+    std::vector<const test_case*> selected;
+    size_t width = 24;
+    for (const auto& test : registered_tests()) {
+        if (internal::test_filter_match(filter, test.name)) {
+            selected.push_back(&test);
+            width = std::max(width, test.name.size());
+        }
     }
-    print(args...);
-}
-// Base case for the recursive calls
-inline void print() {}
 
-// ------------------------------------------------------------------------------------------ log
+    unsigned threads = 1;
+    if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+        threads = internal::as_parallel(policy).threads;
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::clamp<size_t>(selected.size(), 1, threads));
+
+    test_results results;
+    results.tests.resize(selected.size());
+    results.threads = threads;
+
+    // Tests are handed out one at a time, so a slow one doesn't hold up a whole share
+    std::atomic<size_t> next{0};
+    std::mutex          output_mutex;
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < selected.size(); ) {
+            results.tests[i] = internal::run_test(*selected[i]);
+            const std::string verdict = internal::test_verdict(results.tests[i], width);
+            std::lock_guard lock(output_mutex);
+            print(verdict);
+        }
+    };
 
-// Handles logging a single item
-template <class T>
-void log(const T& x)
-{
-    print(x, '\n');
+    zen::timer timer;
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(work);
+    work(); // the calling thread is one of the workers
+    for (auto& t : pool)
+        t.join();
+    timer.stop();
+    results.duration = timer.duration();
+
+    const size_t failed = results.failed();
+    std::string summary = std::to_string(results.tests.size()) + " TESTS, " + std::to_string(results.passed()) + " PASSED, ";
+    if (failed)
+        color::red(std::to_string(failed) + " FAILED").append_to(summary);
+    else
+        summary += "0 FAILED";
+    summary += " IN " + timer.duration_string() + " ON " + std::to_string(threads) + (threads == 1 ? " THREAD" : " THREADS");
+    log(summary);
+    for (const auto& t : results.tests)
+        if (!t.passed())
+            log(color::red("FAILED:"), t.name);
+    return results;
 }
 
-// Generic, almost Python-like log(). Works similar to the print() function but adds std::endl
-template <class T, class... Args>
-void log(T x, Args... args) {
-    print(x, args...);
-    std::cout << std::endl;
+inline test_results run_tests(const std::string_view filter = "*")
+{
+    return run_tests(execution::par, filter);
 }
-// Base case for the recursive calls
-inline void log() {}
 
 ///////////////////////////////////////////////////////////////////////////////////////////// COMPOSITES
 
@@ -2190,4 +7915,179 @@ using strings    = stringvec;
 using points     = points2d;
 using ints       = integers;
 
-} // namespace zen
\ No newline at end of file
+// The containers on polymorphic allocators, like their namesakes in std::pmr.
+// Elements come from the memory resource passed to the constructor (the
+// default resource otherwise), such as a std::pmr::monotonic_buffer_resource
+// on a stack buffer. The resource has to outlive the container.
+// Example: std::array<std::byte, 4096> buffer;
+//          std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+//          zen::pmr::vector<int> v(&arena);
+namespace pmr {
+    template<class T> using vector       = zen::vector<      T, std::pmr::polymorphic_allocator<T>>;
+    template<class T> using deque        = zen::deque<       T, std::pmr::polymorphic_allocator<T>>;
+    template<class T> using list         = zen::list<        T, std::pmr::polymorphic_allocator<T>>;
+    template<class T> using forward_list = zen::forward_list<T, std::pmr::polymorphic_allocator<T>>;
+
+    template<class K, class C = std::less<K>>
+    using set      = zen::set<     K, C, std::pmr::polymorphic_allocator<K>>;
+    template<class K, class C = std::less<K>>
+    using multiset = zen::multiset<K, C, std::pmr::polymorphic_allocator<K>>;
+    template<class K, class C = std::less<K>>
+    using flat_set = zen::flat_set<K, C, std::pmr::polymorphic_allocator<K>>;
+
+    template<class K, class V, class C = std::less<K>>
+    using map      = zen::map<     K, V, C, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+    template<class K, class V, class C = std::less<K>>
+    using multimap = zen::multimap<K, V, C, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+    template<class K, class V, class C = std::less<K>>
+    using flat_map = zen::flat_map<K, V, C, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+
+    template<class T, class H = std::hash<T>, class E = std::equal_to<T>>
+    using unordered_set      = zen::unordered_set<     T, H, E, std::pmr::polymorphic_allocator<T>>;
+    template<class T, class H = std::hash<T>, class E = std::equal_to<T>>
+    using unordered_multiset = zen::unordered_multiset<T, H, E, std::pmr::polymorphic_allocator<T>>;
+
+    template<class K, class V, class H = std::hash<K>, class E = std::equal_to<K>>
+    using unordered_map      = zen::unordered_map<     K, V, H, E, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+    template<class K, class V, class H = std::hash<K>, class E = std::equal_to<K>>
+    using unordered_multimap = zen::unordered_multimap<K, V, H, E, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+    template<class K, class V, class H = std::hash<K>, class E = std::equal_to<K>>
+    using flat_hash_map      = zen::flat_hash_map<     K, V, H, E, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+} // namespace pmr
+
+} // namespace zen
+
+///////////////////////////////////////////////////////////////////////////////////////////// ALLOCATION TRACKING (operators)
+//
+// The replacements of the global allocation functions behind zen::allocation_guard.
+// They can't be inline, hence the one translation unit rule of ZEN_TRACK_ALLOCATIONS.
+
+#if defined(ZEN_TRACK_ALLOCATIONS)
+
+namespace zen::internal {
+    inline void* tracked_allocate(std::size_t n, std::size_t alignment)
+    {
+        auto& counts = thread_allocation_counts();
+        ++counts.allocations;
+        counts.bytes += n;
+        if (n == 0)
+            n = 1; // every allocation has to return a distinct pointer
+        void* p = nullptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            p = std::malloc(n);
+        } else {
+#if defined(_WIN32)
+            p = _aligned_malloc(n, alignment);
+#else
+            if (::posix_memalign(&p, alignment, n) != 0)
+                p = nullptr;
+#endif
+        }
+        return p;
+    }
+
+    inline void tracked_free(void* p, std::size_t alignment)
+    {
+        if (!p)
+            return;
+        ++thread_allocation_counts().deallocations;
+#if defined(_WIN32)
+        if (alignment > alignof(std::max_align_t)) {
+            _aligned_free(p);
+            return;
+        }
+#endif
+        (void) alignment;
+        std::free(p);
+    }
+
+    inline void* tracked_new(std::size_t n, std::size_t alignment)
+    {
+        if (void* p = tracked_allocate(n, alignment))
+            return p;
+        throw std::bad_alloc();
+    }
+} // namespace zen::internal
+
+void* operator new(  std::size_t n)                                        { return zen::internal::tracked_new(n, 0); }
+void* operator new[](std::size_t n)                                        { return zen::internal::tracked_new(n, 0); }
+void* operator new(  std::size_t n, std::align_val_t a)                    { return zen::internal::tracked_new(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a)                    { return zen::internal::tracked_new(n, static_cast<std::size_t>(a)); }
+void* operator new(  std::size_t n, const std::nothrow_t&) noexcept        { return zen::internal::tracked_allocate(n, 0); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept        { return zen::internal::tracked_allocate(n, 0); }
+void* operator new(  std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return zen::internal::tracked_allocate(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return zen::internal::tracked_allocate(n, static_cast<std::size_t>(a)); }
+
+void operator delete(  void* p) noexcept                                   { zen::internal::tracked_free(p, 0); }
+void operator delete[](void* p) noexcept                                   { zen::internal::tracked_free(p, 0); }
+void operator delete(  void* p, std::size_t) noexcept                      { zen::internal::tracked_free(p, 0); }
+void operator delete[](void* p, std::size_t) noexcept                      { zen::internal::tracked_free(p, 0); }
+void operator delete(  void* p, std::align_val_t a) noexcept               { zen::internal::tracked_free(p, static_cast<std::size_t>(a)); }
+void operator delete[](void* p, std::align_val_t a) noexcept               { zen::internal::tracked_free(p, static_cast<std::size_t>(a)); }
+void operator delete(  void* p, std::size_t, std::align_val_t a) noexcept  { zen::internal::tracked_free(p, static_cast<std::size_t>(a)); }
+void operator delete[](void* p, std::size_t, std::align_val_t a) noexcept  { zen::internal::tracked_free(p, static_cast<std::size_t>(a)); }
+void operator delete(  void* p, const std::nothrow_t&) noexcept            { zen::internal::tracked_free(p, 0); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept            { zen::internal::tracked_free(p, 0); }
+void operator delete(  void* p, std::align_val_t a, const std::nothrow_t&) noexcept { zen::internal::tracked_free(p, static_cast<std::size_t>(a)); }
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept { zen::internal::tracked_free(p, static_cast<std::size_t>(a)); }
+
+#endif // ZEN_TRACK_ALLOCATIONS
+
+///////////////////////////////////////////////////////////////////////////////////////////// std::formatter
+
+#if __has_include(<format>)
+#include <format>
+#endif
+
+#if defined(__cpp_lib_format) && __cpp_lib_format >= 201907L
+
+// zen::string is a distinct type from std::string and needs its own formatter
+template<>
+struct std::formatter<zen::string, char> : std::formatter<std::string_view, char> {};
+
+// Colored text honors zen::color::enabled() and the field's width, fill and alignment.
+// The width counts the visible text only: the text is padded first, then the escape
+// codes go around the padded field.
+template<>
+struct std::formatter<zen::color::color_view, char> : std::formatter<std::string_view, char>
+{
+    template<class FormatContext>
+    auto format(const zen::color::color_view& cv, FormatContext& ctx) const
+    {
+        if (!zen::color::enabled())
+            return std::formatter<std::string_view, char>::format(cv.text, ctx);
+
+        char prefix[16] = "\033[";
+        char* end = std::to_chars(prefix + 2, prefix + sizeof(prefix) - 1, cv.code).ptr;
+        *end++ = 'm';
+        ctx.advance_to(std::copy(prefix, end, ctx.out()));
+        auto out = std::formatter<std::string_view, char>::format(cv.text, ctx);
+        const std::string_view reset = "\033[0m";
+        return std::copy(reset.begin(), reset.end(), out);
+    }
+};
+
+template<>
+struct std::formatter<zen::color::color_string, char> : std::formatter<zen::color::color_view, char>
+{
+    template<class FormatContext>
+    auto format(const zen::color::color_string& cs, FormatContext& ctx) const
+    {
+        return std::formatter<zen::color::color_view, char>::format(zen::color::color_view(cs.text, cs.code), ctx);
+    }
+};
+
+// Example: std::format("{}", zen::show(std::tuple{1, "two", 3.0}));
+// Result:  {1, "two", 3}
+template<class T>
+struct std::formatter<zen::internal::shown<T>, char> : std::formatter<std::string_view, char>
+{
+    template<class FormatContext>
+    auto format(const zen::internal::shown<T>& x, FormatContext& ctx) const
+    {
+        std::string buf;
+        zen::internal::append_to(buf, x.ref);
+        return std::formatter<std::string_view, char>::format(buf, ctx);
+    }
+};
+#endif
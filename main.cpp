@@ -9,6 +9,7 @@
 #include <stdexcept>
 #include <cstring> 
 
+#define ZEN_TRACK_ALLOCATIONS // count heap allocations, see zen::allocation_guard
 #include "kaizen.h" 
 
 double random_double(double min, double max) {
@@ -82,9 +83,14 @@ int main(int argc, char* argv[]) {
     auto [size, offset, iterations, trials] = process_args(argc, argv);
     std::vector<double> aligned_times(trials), unaligned_times(trials);
 
+    zen::sampler::instance().start(1000); // hotspots per ZEN_PROFILE label, see the report below
     for (int trial = 0; trial < trials; ++trial) {
+        ZEN_PROFILE("trial");
         std::vector<double> data(size);
-        initialize_vector(data.data(), size);
+        {
+            ZEN_PROFILE("initialize_vector");
+            initialize_vector(data.data(), size);
+        }
     
         const double* aligned_ptr = data.data();
     
@@ -92,44 +98,70 @@ int main(int argc, char* argv[]) {
         uint8_t* bytes = reinterpret_cast<uint8_t*>(raw);
         double* unaligned_ptr = reinterpret_cast<double*>(bytes + offset);
     
-        std::memcpy(unaligned_ptr, aligned_ptr, size * sizeof(double));
+        {
+            ZEN_PROFILE("memcpy");
+            std::memcpy(unaligned_ptr, aligned_ptr, size * sizeof(double));
+        }
     
         std::cout << "Trial " << trial << ":\n";
     
         // Flush before aligned sum  
-        _mm_mfence();
-        flush_data(aligned_ptr, size);
-        flush_data(unaligned_ptr, size); // ensure no overlap cache reuse
-        _mm_mfence();
+        {
+            ZEN_PROFILE("flush_data");
+            _mm_mfence();
+            flush_data(aligned_ptr, size);
+            flush_data(unaligned_ptr, size); // ensure no overlap cache reuse
+            _mm_mfence();
+        }
     
         double aligned_sum = 0;
-        auto start = std::chrono::high_resolution_clock::now();
-        for (int i = 0; i < iterations; ++i) {
-            aligned_sum += sum_aligned(aligned_ptr, size);
+        size_t aligned_allocations = 0;
+        {
+            ZEN_PROFILE("sum_aligned"); // before the guard, as its first use allocates the entry
+            zen::allocation_guard guard("aligned sum loop", zen::allocation_policy::abort);
+            zen::timer timer; // steady_clock, unlike high_resolution_clock on some standard libraries
+            for (int i = 0; i < iterations; ++i) {
+                aligned_sum += sum_aligned(aligned_ptr, size);
+            }
+            timer.stop();
+            aligned_times[trial] = std::chrono::duration<double, std::nano>(timer.duration()).count() / iterations;
+            aligned_allocations = guard.allocations();
         }
-        auto end = std::chrono::high_resolution_clock::now();
-        aligned_times[trial] = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
-        std::cout << "  Aligned sum   = " << aligned_sum << "\n";
+        std::cout << "  Aligned sum   = " << aligned_sum << " (" << aligned_allocations << " allocations)\n";
     
         // Flush before unaligned sum  
-        _mm_mfence();
-        flush_data(aligned_ptr, size);
-        flush_data(unaligned_ptr, size); // again to avoid cache overlap
-        _mm_mfence();
+        {
+            ZEN_PROFILE("flush_data");
+            _mm_mfence();
+            flush_data(aligned_ptr, size);
+            flush_data(unaligned_ptr, size); // again to avoid cache overlap
+            _mm_mfence();
+        }
     
         double unaligned_sum = 0;
-        start = std::chrono::high_resolution_clock::now();
-        for (int i = 0; i < iterations; ++i) {
-            unaligned_sum += sum_misaligned(unaligned_ptr, size);
+        size_t unaligned_allocations = 0;
+        {
+            ZEN_PROFILE("sum_misaligned");
+            zen::allocation_guard guard("unaligned sum loop", zen::allocation_policy::abort);
+            zen::timer timer; // steady_clock, unlike high_resolution_clock on some standard libraries
+            for (int i = 0; i < iterations; ++i) {
+                unaligned_sum += sum_misaligned(unaligned_ptr, size);
+            }
+            timer.stop();
+            unaligned_times[trial] = std::chrono::duration<double, std::nano>(timer.duration()).count() / iterations;
+            unaligned_allocations = guard.allocations();
         }
-        end = std::chrono::high_resolution_clock::now();
-        unaligned_times[trial] = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
-        std::cout << "  Unaligned sum = " << unaligned_sum << "\n";
+        std::cout << "  Unaligned sum = " << unaligned_sum << " (" << unaligned_allocations << " allocations)\n";
     
         std::free(raw);
     }
     
 
+    zen::sampler::instance().stop();
+
+    zen::print(zen::profiler::instance().report());
+    zen::print(zen::sampler::instance().report(5));
+
     double avg_aligned = std::accumulate(aligned_times.begin(), aligned_times.end(), 0.0) / trials;
     double avg_unaligned = std::accumulate(unaligned_times.begin(), unaligned_times.end(), 0.0) / trials;
     double speedUP_factor = ((avg_unaligned - avg_aligned)/avg_unaligned)*100;
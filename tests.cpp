@@ -0,0 +1,255 @@
+// The ZEN_TEST checks of kaizen.h, run by ctest (see CMakeLists.txt).
+// Run a subset with --filter, e.g. tests --filter "pmr_*,-*swap*"
+
+#include <algorithm>
+#include <memory_resource>
+#include <string>
+
+#include "kaizen.h"
+
+// ------------------------------------------------------------------------------------------ flat containers
+
+// polymorphic_allocator doesn't propagate, so assignment between different resources
+// copies or moves element by element and each map keeps the resource it was built with
+ZEN_TEST(pmr_flat_hash_map_assignment)
+{
+    std::pmr::monotonic_buffer_resource first, second;
+    zen::pmr::flat_hash_map<int, std::string> a(&first), b(&second), c(&second);
+    for (int i = 0; i < 100; ++i)
+        b[i] = std::to_string(i);
+
+    a = b;
+    ZEN_EXPECT(a == b);
+    ZEN_EXPECT(a.get_allocator().resource() == &first);
+
+    c = std::move(b); // same resource, so the table changes hands
+    ZEN_EXPECT(c == a);
+    ZEN_EXPECT(b.is_empty());
+    ZEN_EXPECT(c.get_allocator().resource() == &second);
+
+    b = std::move(a); // different resources
+    ZEN_EXPECT(b == c);
+    ZEN_EXPECT(b.get_allocator().resource() == &second);
+
+    zen::pmr::flat_hash_map<int, std::string> d(&second);
+    d.swap(b);
+    ZEN_EXPECT(d == c);
+    ZEN_EXPECT(b.is_empty());
+
+    a = a;
+    ZEN_EXPECT(a.get_allocator().resource() == &first);
+}
+
+ZEN_TEST(flat_hash_map_assignment)
+{
+    zen::flat_hash_map<std::string, int> a = {{"one", 1}, {"two", 2}}, b;
+    b = a;
+    ZEN_EXPECT(b == a);
+    zen::flat_hash_map<std::string, int> c;
+    c = std::move(b);
+    ZEN_EXPECT(c == a);
+    ZEN_EXPECT(b.is_empty());
+    c.swap(b);
+    ZEN_EXPECT(b == a);
+    ZEN_EXPECT(c.is_empty());
+}
+
+ZEN_TEST(pmr_flat_map_assignment)
+{
+    std::pmr::monotonic_buffer_resource first, second;
+    zen::pmr::flat_map<int, int> a(&first), b(&second);
+    zen::pmr::flat_set<int>      s(&first), t(&second);
+    for (int i = 0; i < 100; ++i) {
+        b[i] = i * i;
+        t.insert(i);
+    }
+    a = b;
+    s = std::move(t);
+    ZEN_EXPECT(a == b);
+    ZEN_EXPECT(s.size() == 100);
+    ZEN_EXPECT(a.get_allocator().resource() == &first);
+    ZEN_EXPECT(s.get_allocator().resource() == &first);
+}
+
+// ------------------------------------------------------------------------------------------ indexing
+
+ZEN_TEST(indexed_vector_follows_changes)
+{
+    zen::indexed_vector<std::string> v = {"0", "1", "2"};
+    ZEN_EXPECT(v.contains("1"));
+    v.push_back("new");
+    v.set(0, "zero");
+    ZEN_EXPECT(v.contains("new"));
+    ZEN_EXPECT(v.contains("zero"));
+    ZEN_EXPECT(!v.contains("0"));
+    v.modify([](auto& c) { c.erase(c.begin()); });
+    ZEN_EXPECT(!v.contains("zero"));
+
+    zen::indexed_deque<int> d = {1, 2, 3};
+    ZEN_EXPECT(!d.contains(0));
+    d.push_front(0);
+    ZEN_EXPECT(d.contains(0));
+}
+
+// ------------------------------------------------------------------------------------------ random
+
+// The engines of threads started after seed_random() get their own streams, the same on every run
+ZEN_TEST(seeded_thread_streams)
+{
+    auto first_draws = [] {
+        zen::seed_random(42);
+        std::vector<std::vector<uint64_t>> draws(4);
+        for (auto& d : draws) // one thread after the other, so they take the streams in order
+            std::thread([&d] { for (int i = 0; i < 64; ++i) d.push_back(zen::random_engine()()); }).join();
+        return draws;
+    };
+    const auto draws = first_draws();
+    ZEN_EXPECT(draws == first_draws());
+
+    std::unordered_set<uint64_t> seen;
+    for (const auto& d : draws)
+        seen.insert(d.begin(), d.end());
+    ZEN_EXPECT(seen.size() == 4 * 64);
+}
+
+// ------------------------------------------------------------------------------------------ kd_tree
+
+namespace {
+
+double distance2(const zen::point2d& a, const zen::point2d& b)
+{
+    return (a.x() - b.x()) * (a.x() - b.x()) + (a.y() - b.y()) * (a.y() - b.y());
+}
+
+// What kd_tree2d::nearest() must return: the k closest points by a full scan, ties by index
+std::vector<size_t> scan_nearest(const std::vector<zen::point2d>& points, const zen::point2d& q, size_t k)
+{
+    std::vector<std::pair<double, size_t>> all;
+    for (size_t i = 0; i < points.size(); ++i)
+        all.emplace_back(distance2(points[i], q), i);
+    std::sort(all.begin(), all.end());
+    std::vector<size_t> result;
+    for (size_t i = 0; i < std::min(k, all.size()); ++i)
+        result.push_back(all[i].second);
+    return result;
+}
+
+std::vector<size_t> scan_within(const std::vector<zen::point2d>& points, const zen::point2d& q, double radius)
+{
+    std::vector<size_t> result;
+    for (size_t i = 0; i < points.size(); ++i)
+        if (distance2(points[i], q) <= radius * radius)
+            result.push_back(i);
+    return result;
+}
+
+} // namespace
+
+// Against linear scans, on random points and on a grid with many ties and duplicates
+ZEN_TEST(kd_tree_matches_scans)
+{
+    zen::xoshiro256ss engine(7);
+    std::vector<double> coordinates(2 * 3000);
+    zen::fill_random(std::span<double>(coordinates), 0.0, 1.0, engine);
+    std::vector<zen::point2d> random_points, grid_points, queries;
+    for (size_t i = 0; i < 2000; ++i)
+        random_points.emplace_back(coordinates[2 * i], coordinates[2 * i + 1]);
+    for (size_t i = 2000; i < 3000; ++i)
+        queries.emplace_back(coordinates[2 * i], coordinates[2 * i + 1]);
+    for (size_t i = 0; i < 2000; ++i)
+        grid_points.emplace_back(static_cast<double>(i % 16) / 16, static_cast<double>(i % 23 % 16) / 16);
+    queries.emplace_back(0.5, 0.5); // on grid points
+
+    for (const auto* points : { &random_points, &grid_points }) {
+        const zen::kd_tree2d tree(*points);
+        const zen::kd_tree2d par_tree(zen::execution::par(4), *points);
+        for (size_t k : { size_t{1}, size_t{8}, size_t{50} }) {
+            const auto batched = par_tree.nearest(zen::execution::par(4), queries, k);
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto expected = scan_nearest(*points, queries[i], k);
+                ZEN_EXPECT(tree.nearest(queries[i], k) == expected);
+                ZEN_EXPECT(std::equal(expected.begin(), expected.end(), batched.begin() + i * k));
+            }
+        }
+        for (double radius : { 0.0, 0.03, 0.1 }) {
+            const zen::neighbours batched = par_tree.within(zen::execution::par(4), queries, radius);
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto expected = scan_within(*points, queries[i], radius);
+                auto single = tree.within(queries[i], radius);
+                std::vector<size_t> from_batch(batched[i].begin(), batched[i].end());
+                std::sort(single.begin(), single.end());
+                std::sort(from_batch.begin(), from_batch.end());
+                ZEN_EXPECT(single == expected);
+                ZEN_EXPECT(from_batch == expected);
+            }
+        }
+    }
+    ZEN_EXPECT(zen::kd_tree2d(grid_points).nearest(zen::point2d(2, 2), 5000).size() == grid_points.size());
+}
+
+// ------------------------------------------------------------------------------------------ timer
+
+// Counted from the calibration, the readings start near zero and keep pace with the steady_clock
+ZEN_TEST(tsc_clock_readings)
+{
+    const auto first = zen::tsc_clock::now();
+    ZEN_EXPECT(first.time_since_epoch() < std::chrono::hours(1));
+
+    const auto s0 = std::chrono::steady_clock::now();
+    const auto t0 = zen::tsc_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto t1 = zen::tsc_clock::now();
+    const auto s1 = std::chrono::steady_clock::now();
+    ZEN_EXPECT(first <= t0 && t0 < t1);
+    ZEN_EXPECT(t1 - t0 <= s1 - s0 + std::chrono::milliseconds(1));
+    ZEN_EXPECT(t1 - t0 >= std::chrono::milliseconds(19));
+}
+
+ZEN_TEST(timer_reserved_laps)
+{
+    zen::timer t;
+    t.reserve_laps(8).start();
+    const auto* data = t.laps().data();
+    for (int i = 0; i < 8; ++i)
+        t.lap();
+    ZEN_EXPECT(t.laps().size() == 8);
+    ZEN_EXPECT(t.laps().data() == data); // no reallocation
+    t.start();
+    ZEN_EXPECT(t.laps().empty() && t.laps().capacity() >= 8);
+}
+
+// ------------------------------------------------------------------------------------------ version
+
+using namespace zen::literals::version;
+
+static_assert("1.0.0.123456"_version.build() == 123456);
+static_assert("0.0.0.2147483647"_version < "1.0.0.0"_version);
+static_assert("1.2.3.70000"_version > "1.2.3.65535"_version);
+
+ZEN_TEST(version_parsing)
+{
+    ZEN_EXPECT(zen::version("1.0.0.123456").build() == 123456);
+    ZEN_EXPECT(zen::version("000001.2.3.4") == zen::version(1, 2, 3, 4));
+    ZEN_EXPECT(zen::version::parse("2147483647.0.0.0").has_value());
+    ZEN_EXPECT(!zen::version::parse("2147483648.0.0.0"));
+    ZEN_EXPECT(!zen::version::parse("1.2.3"));
+    ZEN_EXPECT(!zen::version::parse("1.2.3.-4"));
+    ZEN_EXPECT(!zen::version::parse("1.2.3.4."));
+}
+
+ZEN_TEST(version_ordering)
+{
+    ZEN_EXPECT(zen::version(1, 2, 3, 70000) > zen::version(1, 2, 3, 65535));
+    ZEN_EXPECT(zen::version(1, 2, 70000, 0) > zen::version(1, 2, 3, 2000000));
+    ZEN_EXPECT(zen::version(2, 0, 0, 0) > zen::version(1, 2147483647, 0, 0));
+    ZEN_EXPECT(zen::version(1, -1, 0, 0) < zen::version(1, 0, 0, 0));
+    ZEN_EXPECT(zen::version(0, 0, 0, -5) < zen::version(0, 0, 0, 0));
+}
+
+int main(int argc, char* argv[])
+{
+    zen::cmd_args args(argv, argc);
+    auto filter  = args.get_options("--filter");
+    auto results = zen::run_tests(zen::execution::par, filter.empty() ? "*" : filter[0]);
+    return results.failed() == 0 ? 0 : 1;
+}